@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_AlertBus.h"
+#include "AI_LevelController.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Alert Delivery"), STAT_AI_AlertDelivery, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Alerts Pushed"), STAT_AI_AlertsPushed, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Alerts Merged"), STAT_AI_AlertsMerged, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Alerted"), STAT_AI_Alerted, STATGROUP_TimeThiefAI);
+
+void FAI_AlertBus::Push(const FAI_Alert& Alert)
+{
+	INC_DWORD_STAT(STAT_AI_AlertsPushed);
+	Alerts.Add(Alert);
+}
+
+void FAI_AlertBus::Deliver(const AAI_LevelController& LevelController, const TConstArrayView<FAI_AlertSettings> Settings,
+	const float MergeDistance)
+{
+	if (Alerts.Num() == 0)
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_AI_AlertDelivery);
+
+	// Alerts of one kind close together are one event, e.g. a burst of gunfire
+	// Alerts with a target are kept, the target has to hear its own
+	const float MergeDistanceSquared = FMath::Square(MergeDistance);
+	for (int32 Index = 0; Index < Alerts.Num(); Index++)
+	{
+		for (int32 Other = Alerts.Num() - 1; Other > Index; Other--)
+		{
+			const FAI_Alert& Alert = Alerts[Index];
+			const FAI_Alert& OtherAlert = Alerts[Other];
+
+			if (Alert.Type != OtherAlert.Type || Alert.Target.IsSet() || OtherAlert.Target.IsSet()
+				|| FVector::DistSquared(Alert.Location, OtherAlert.Location) > MergeDistanceSquared)
+				continue;
+
+			Alerts[Index].RadiusOverride = Alert.RadiusOverride > 0.f && OtherAlert.RadiusOverride > 0.f
+				? FMath::Max(Alert.RadiusOverride, OtherAlert.RadiusOverride)
+				: 0.f;
+			if (Alert.Source != OtherAlert.Source)
+				Alerts[Index].Source.Reset();
+
+			Alerts.RemoveAtSwap(Other, 1, false);
+			INC_DWORD_STAT(STAT_AI_AlertsMerged);
+		}
+	}
+
+	auto Consider = [this](const FAI_PawnHandle Handle, const float Strength, const FVector& Location)
+		{
+			if (static_cast<int32>(Handle.Index) >= BestStrengths.Num())
+			{
+				BestStrengths.SetNumZeroed(Handle.Index + 1, false);
+				BestLocations.SetNumZeroed(Handle.Index + 1, false);
+				BestHandles.SetNum(Handle.Index + 1, false);
+			}
+
+			if (BestStrengths[Handle.Index] <= 0.f)
+				AlertedSlots.Add(Handle.Index);
+
+			if (Strength > BestStrengths[Handle.Index])
+			{
+				BestStrengths[Handle.Index] = Strength;
+				BestLocations[Handle.Index] = Location;
+				BestHandles[Handle.Index] = Handle;
+			}
+		};
+
+	// Every AI keeps only its strongest alert
+	for (const FAI_Alert& Alert : Alerts)
+	{
+		const FAI_AlertSettings& AlertSettings = Settings[Alert.Type];
+		const float Radius = Alert.RadiusOverride > 0.f ? Alert.RadiusOverride : AlertSettings.Radius;
+
+		if (Alert.Target.IsSet())
+			Consider(Alert.Target, 1.f, Alert.Location);
+
+		if (Radius <= 0.f)
+			continue;
+
+		QueryBuffer.Reset();
+		LevelController.QueryAIInRadius(Alert.Location, Radius, QueryBuffer);
+
+		for (const AAI_PawnBase* Pawn : QueryBuffer)
+		{
+			const FAI_PawnHandle Handle = Pawn->GetPawnHandle();
+			if (Handle == Alert.Source || Handle == Alert.Target)
+				continue;
+
+			const float Distance = FVector::Dist(Pawn->GetActorLocation(), Alert.Location);
+			const float Strength = FMath::Pow(FMath::Max(1.f - Distance / Radius, 0.f), AlertSettings.Falloff);
+			if (Strength >= AlertSettings.MinStrength && Strength > 0.f)
+				Consider(Handle, Strength, Alert.Location);
+		}
+	}
+
+	Alerts.Reset();
+
+	// Responding may push new alerts, they are delivered next frame
+	for (const int32 Slot : AlertedSlots)
+	{
+		if (AAI_PawnBase* Pawn = LevelController.ResolvePawn(BestHandles[Slot]); Pawn && !Pawn->bIsDead)
+		{
+			Pawn->RespondTo(BestLocations[Slot]);
+			INC_DWORD_STAT(STAT_AI_Alerted);
+		}
+
+		BestStrengths[Slot] = 0.f;
+		BestHandles[Slot].Reset();
+	}
+	AlertedSlots.Reset();
+}
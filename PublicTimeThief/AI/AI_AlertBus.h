@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI_PawnHandle.h"
+#include "AI_AlertBus.generated.h"
+
+class AAI_LevelController;
+class AAI_PawnBase;
+
+// What raised an alert, each kind has its own propagation settings
+UENUM(BlueprintType)
+namespace EAI_AlertType
+{
+	enum EType
+	{
+		Gunshot,
+		Damage,
+		Sighting,
+		Num		UMETA(Hidden)
+	};
+}
+
+/**
+ * How far an alert of one kind reaches and how quickly it fades
+ */
+USTRUCT(BlueprintType)
+struct FAI_AlertSettings
+{
+	GENERATED_BODY()
+
+	FAI_AlertSettings() = default;
+	FAI_AlertSettings(const float InRadius, const float InFalloff, const float InMinStrength)
+		: Radius(InRadius), Falloff(InFalloff), MinStrength(InMinStrength)
+	{
+	}
+
+	// AI further than this from the alert never hear it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float Radius = 2500.f;
+
+	// Strength is (1 - Distance / Radius) ^ Falloff, higher fades faster
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.1))
+	float Falloff = 1.f;
+
+	// AI only respond to alerts at least this strong
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0, ClampMax = 1))
+	float MinStrength = 0.1f;
+};
+
+// One alert waiting for the next delivery
+struct FAI_Alert
+{
+	FVector Location = FVector::ZeroVector;
+	// Radius to use instead of the kind's, 0 uses the kind's
+	float RadiusOverride = 0.f;
+	// AI that raised it, it never responds to its own alert
+	FAI_PawnHandle Source;
+	// AI that always responds at full strength, e.g. the one that was shot
+	FAI_PawnHandle Target;
+	EAI_AlertType::EType Type = EAI_AlertType::Sighting;
+};
+
+/**
+ * Collects alerts during the frame and delivers them in one pass on the Game Thread
+ * Alerts of the same kind close together are merged, and every AI responds at most once a frame, to its strongest alert
+ * Game Thread only
+ */
+class FAI_AlertBus
+{
+public:
+	void Push(const FAI_Alert& Alert);
+
+	// Merges the frame's alerts and calls RespondTo on every AI that hears one, Settings is indexed by EAI_AlertType
+	void Deliver(const AAI_LevelController& LevelController, TConstArrayView<FAI_AlertSettings> Settings, float MergeDistance);
+
+	FORCEINLINE int32 NumQueued() const { return Alerts.Num(); }
+
+private:
+	TArray<FAI_Alert> Alerts;
+
+	// Strongest alert of each AI this delivery, indexed by registry slot
+	TArray<float> BestStrengths;
+	TArray<FVector> BestLocations;
+	TArray<FAI_PawnHandle> BestHandles;
+	TArray<int32> AlertedSlots;
+
+	// Reused for every radius query
+	TArray<AAI_PawnBase*> QueryBuffer;
+};
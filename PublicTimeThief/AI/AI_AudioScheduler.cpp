@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_AudioScheduler.h"
+#include "AI_LevelController.h"
+#include "Algo/Sort.h"
+#include "Components/AudioComponent.h"
+#include "Sound/SoundAttenuation.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Audio Scheduler"), STAT_AI_AudioScheduler, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Sounds Played"), STAT_AI_SoundsPlayed, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Sounds Culled"), STAT_AI_SoundsCulled, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Sounds Dropped"), STAT_AI_SoundsDropped, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Sounds Stolen"), STAT_AI_SoundsStolen, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI Voices Playing"), STAT_AI_VoicesPlaying, STATGROUP_TimeThiefAI);
+
+void FAI_AudioScheduler::Queue(const FAI_SoundRequest& Request)
+{
+	if (Request.Sound)
+		Requests.Add(Request);
+}
+
+void FAI_AudioScheduler::Process(AActor& Owner, const TConstArrayView<FAI_Viewpoint> Viewpoints,
+	const TConstArrayView<FAI_SoundCategorySettings> Settings, const int32 MaxVoices)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AI_AudioScheduler);
+
+	int32 CategoryVoices[EAI_SoundCategory::Num] = {};
+	int32 PlayingVoices = 0;
+	for (const FVoice& Voice : Voices)
+	{
+		if (const UAudioComponent* Component = Voice.Component.Get(); Component && Component->IsPlaying())
+		{
+			CategoryVoices[Voice.Category]++;
+			PlayingVoices++;
+		}
+	}
+
+	if (Requests.Num() == 0)
+	{
+		SET_DWORD_STAT(STAT_AI_VoicesPlaying, PlayingVoices);
+		return;
+	}
+
+	// Nobody can hear a sound further than its attenuation or its category allows
+	for (int32 Index = Requests.Num() - 1; Index >= 0; Index--)
+	{
+		FAI_SoundRequest& Request = Requests[Index];
+		const FAI_SoundCategorySettings& CategorySettings = Settings[Request.Category];
+
+		float MaxDistance = CategorySettings.MaxDistance;
+		if (Request.Attenuation)
+			MaxDistance = FMath::Min(MaxDistance, Request.Attenuation->Attenuation.GetMaxDimension());
+
+		float ClosestSquared = MAX_flt;
+		for (const FAI_Viewpoint& Viewpoint : Viewpoints)
+			ClosestSquared = FMath::Min(ClosestSquared, FVector::DistSquared(Viewpoint.Location, Request.Location));
+
+		if (CategorySettings.MaxVoices <= 0 || ClosestSquared > FMath::Square(MaxDistance))
+		{
+			Requests.RemoveAtSwap(Index, 1, false);
+			INC_DWORD_STAT(STAT_AI_SoundsCulled);
+			continue;
+		}
+
+		Request.Priority = CategorySettings.Priority * (1.f - FMath::Sqrt(ClosestSquared) / FMath::Max(MaxDistance, 1.f));
+	}
+
+	Algo::SortBy(Requests, &FAI_SoundRequest::Priority, TGreater<>());
+
+	for (const FAI_SoundRequest& Request : Requests)
+	{
+		FVoice* Voice = nullptr;
+
+		if (CategoryVoices[Request.Category] >= Settings[Request.Category].MaxVoices)
+			Voice = FindVoiceToSteal(Request.Category, Request.Priority);
+		else if (PlayingVoices >= MaxVoices)
+			Voice = FindVoiceToSteal(EAI_SoundCategory::Num, Request.Priority);
+		else
+			Voice = FindFreeVoice(Owner, MaxVoices);
+
+		UAudioComponent* Component = Voice ? Voice->Component.Get() : nullptr;
+		if (!Component)
+		{
+			INC_DWORD_STAT(STAT_AI_SoundsDropped);
+			continue;
+		}
+
+		if (Component->IsPlaying())
+		{
+			Component->Stop();
+			CategoryVoices[Voice->Category]--;
+			PlayingVoices--;
+			INC_DWORD_STAT(STAT_AI_SoundsStolen);
+		}
+
+		Component->SetWorldLocation(Request.Location);
+		Component->SetSound(Request.Sound);
+		Component->AttenuationSettings = Request.Attenuation;
+		Component->SetVolumeMultiplier(Request.Volume);
+		Component->SetPitchMultiplier(Request.Pitch);
+		Component->Play();
+
+		Voice->Category = Request.Category;
+		Voice->Priority = Request.Priority;
+		CategoryVoices[Request.Category]++;
+		PlayingVoices++;
+		INC_DWORD_STAT(STAT_AI_SoundsPlayed);
+	}
+
+	Requests.Reset();
+	SET_DWORD_STAT(STAT_AI_VoicesPlaying, PlayingVoices);
+}
+
+void FAI_AudioScheduler::StopAll()
+{
+	for (const FVoice& Voice : Voices)
+	{
+		if (UAudioComponent* Component = Voice.Component.Get())
+			Component->Stop();
+	}
+	Requests.Reset();
+}
+
+FAI_AudioScheduler::FVoice* FAI_AudioScheduler::FindFreeVoice(AActor& Owner, const int32 MaxVoices)
+{
+	for (FVoice& Voice : Voices)
+	{
+		if (const UAudioComponent* Component = Voice.Component.Get(); Component && !Component->IsPlaying())
+			return &Voice;
+	}
+
+	if (Voices.Num() >= MaxVoices)
+		return nullptr;
+
+	// Created once and reused, so a burst of sounds never creates components
+	UAudioComponent* Component = NewObject<UAudioComponent>(&Owner);
+	Component->bAutoActivate = false;
+	Component->bAutoDestroy = false;
+	Component->bAllowSpatialization = true;
+	Component->SetupAttachment(Owner.GetRootComponent());
+	Component->RegisterComponent();
+	Component->SetUsingAbsoluteLocation(true);
+
+	FVoice& Voice = Voices.AddDefaulted_GetRef();
+	Voice.Component = Component;
+	return &Voice;
+}
+
+FAI_AudioScheduler::FVoice* FAI_AudioScheduler::FindVoiceToSteal(const EAI_SoundCategory::EType Category, const float Priority)
+{
+	FVoice* Lowest = nullptr;
+	for (FVoice& Voice : Voices)
+	{
+		const UAudioComponent* Component = Voice.Component.Get();
+		if (!Component || !Component->IsPlaying())
+			continue;
+
+		if (Category != EAI_SoundCategory::Num && Voice.Category != Category)
+			continue;
+
+		if (Voice.Priority < Priority && (!Lowest || Voice.Priority < Lowest->Priority))
+			Lowest = &Voice;
+	}
+	return Lowest;
+}
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI_AudioScheduler.generated.h"
+
+struct FAI_Viewpoint;
+class UAudioComponent;
+class USoundAttenuation;
+class USoundBase;
+
+// Kinds of AI sound, each has its own voice cap and priority
+UENUM(BlueprintType)
+namespace EAI_SoundCategory
+{
+	enum EType
+	{
+		Death,
+		Damage,
+		Combat,
+		Num		UMETA(Hidden)
+	};
+}
+
+/**
+ * Voice limits for one category of AI sound
+ */
+USTRUCT(BlueprintType)
+struct FAI_SoundCategorySettings
+{
+	GENERATED_BODY()
+
+	FAI_SoundCategorySettings() = default;
+	FAI_SoundCategorySettings(const int32 InMaxVoices, const float InPriority, const float InMaxDistance)
+		: MaxVoices(InMaxVoices), Priority(InPriority), MaxDistance(InMaxDistance)
+	{
+	}
+
+	// Sounds of this category playing at once
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 MaxVoices = 4;
+
+	// Higher plays first and may take the voice of a lower priority sound
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float Priority = 1.f;
+
+	// Sounds further than this from every viewpoint are dropped, also limited by the sound's attenuation
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float MaxDistance = 4000.f;
+};
+
+// One sound waiting for the next Process
+struct FAI_SoundRequest
+{
+	USoundBase* Sound = nullptr;
+	USoundAttenuation* Attenuation = nullptr;
+	FVector Location = FVector::ZeroVector;
+	// Already scaled by the pawn's sound class, the class itself is not applied again
+	float Volume = 1.f;
+	float Pitch = 1.f;
+	EAI_SoundCategory::EType Category = EAI_SoundCategory::Combat;
+	// Filled by Process, category priority faded by distance
+	float Priority = 0.f;
+};
+
+/**
+ * Plays the AI's sounds on a small pool of audio components owned by the Level Controller
+ * Requests are culled by distance, then played by priority within per category and global voice caps
+ * Game Thread only
+ */
+class FAI_AudioScheduler
+{
+public:
+	void Queue(const FAI_SoundRequest& Request);
+
+	// Plays or drops every queued request, Settings is indexed by EAI_SoundCategory
+	void Process(AActor& Owner, TConstArrayView<FAI_Viewpoint> Viewpoints, TConstArrayView<FAI_SoundCategorySettings> Settings,
+		int32 MaxVoices);
+
+	// Stops every voice, the components stay with their owner
+	void StopAll();
+
+private:
+	struct FVoice
+	{
+		// Owned and kept alive by the Level Controller
+		TWeakObjectPtr<UAudioComponent> Component;
+		EAI_SoundCategory::EType Category = EAI_SoundCategory::Combat;
+		float Priority = 0.f;
+	};
+
+	// A voice that is not playing, or a new one while there are fewer than MaxVoices
+	FVoice* FindFreeVoice(AActor& Owner, int32 MaxVoices);
+	// The lowest priority playing voice below Priority, of Category or of any category if Category is Num
+	FVoice* FindVoiceToSteal(EAI_SoundCategory::EType Category, float Priority);
+
+	TArray<FAI_SoundRequest> Requests;
+	TArray<FVoice> Voices;
+};
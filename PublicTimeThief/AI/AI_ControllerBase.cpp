@@ -75,13 +75,7 @@ void AAI_ControllerBase::OnPossess(APawn* InPawn)
 		Blackboard->InitializeBlackboard(*BTAsset->BlackboardAsset);
 	}
 
-	if(ANavPath* Path = ControlledCharacter->GetPath(); Path != nullptr)
-	{
-		Blackboard->SetValueAsObject(FName("Path"), Path);
-	}
-
-	const ECombatType::EType CombatType = ControlledCharacter->GetCombatType();
-	Blackboard->SetValueAsEnum(FName("Combat Type"), CombatType);
+	WriteSpawnSetup();
 
 	GEngine->AddOnScreenDebugMessage(-1, 3, FColor::Cyan, (TEXT("%s Possessed~~~~~~~"), *ControlledCharacter->GetActorNameOrLabel()));
 }
@@ -276,6 +270,35 @@ void AAI_ControllerBase::SetEnableThinking(const bool bSet, const TEnumAsByte<EC
 	}
 }
 
+void AAI_ControllerBase::WriteSpawnSetup()
+{
+	if (!IsValid(ControlledCharacter) || !IsValid(Blackboard))
+		return;
+
+	if(ANavPath* Path = ControlledCharacter->GetPath(); Path != nullptr)
+	{
+		Blackboard->SetValueAsObject(FName("Path"), Path);
+	}
+
+	const ECombatType::EType CombatType = ControlledCharacter->GetCombatType();
+	Blackboard->SetValueAsEnum(FName("Combat Type"), CombatType);
+}
+
+void AAI_ControllerBase::ResetForPool()
+{
+	// Nothing perceived in the last life is remembered
+	Perception->ForgetAll();
+	KnownHostileActors.Empty();
+	OutOfSightHostiles.Empty();
+
+	// InitializeBlackboard returns early for the asset the blackboard already has, so every key is cleared
+	if (IsValid(Blackboard) && Blackboard->GetBlackboardAsset())
+	{
+		for (int32 KeyID = 0; KeyID < Blackboard->GetNumKeys(); KeyID++)
+			Blackboard->ClearValue(static_cast<FBlackboard::FKey>(KeyID));
+	}
+}
+
 void AAI_ControllerBase::SetBlackboardVectorWithKey(FVector& Vector, FName Key)
 {
 	Blackboard->SetValueAsVector(Key, Vector);
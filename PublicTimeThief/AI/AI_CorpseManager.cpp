@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_CorpseManager.h"
+#include "AI_LevelController.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Corpses"), STAT_AI_Corpses, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Corpses"), STAT_AI_NumCorpses, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ragdolls Simulating"), STAT_AI_RagdollsSimulating, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Death Animations"), STAT_AI_DeathAnimations, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ragdolls Over Budget"), STAT_AI_RagdollsOverBudget, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Corpses Frozen"), STAT_AI_CorpsesFrozen, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Corpses Removed"), STAT_AI_CorpsesRemoved, STATGROUP_TimeThiefAI);
+
+bool FAI_CorpseManager::Add(AAI_PawnBase* Pawn, const float Now, const float AnimationLength, const FAI_CorpseSettings& Settings)
+{
+	// A pooled AI can die again while its last corpse is still tracked
+	for (int32 Index = Corpses.Num() - 1; Index >= 0; Index--)
+	{
+		if (Corpses[Index].Pawn.Get() == Pawn)
+			RemoveAt(Index);
+	}
+
+	FCorpse& Corpse = Corpses.AddDefaulted_GetRef();
+	Corpse.Pawn = Pawn;
+	Corpse.DeathTime = Now;
+	Corpse.bRagdoll = NumSimulating < Settings.MaxRagdolls || AnimationLength <= 0.f;
+
+	if (Corpse.bRagdoll)
+	{
+		if (NumSimulating >= Settings.MaxRagdolls)
+			INC_DWORD_STAT(STAT_AI_RagdollsOverBudget);
+
+		NumSimulating++;
+		Corpse.FreezeTime = Now + Settings.MaxRagdollTime;
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_AI_DeathAnimations);
+		Corpse.FreezeTime = Now + AnimationLength;
+	}
+
+	return Corpse.bRagdoll;
+}
+
+void FAI_CorpseManager::Update(const float Now, const FAI_CorpseSettings& Settings)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AI_Corpses);
+
+	for (int32 Index = 0; Index < Corpses.Num();)
+	{
+		FCorpse& Corpse = Corpses[Index];
+		AAI_PawnBase* Pawn = Corpse.Pawn.Get();
+
+		// Destroyed, pooled or spawned again elsewhere
+		if (!IsValid(Pawn) || !Pawn->bIsDead || Pawn->IsInPool())
+		{
+			RemoveAt(Index);
+			continue;
+		}
+
+		// Oldest first, so everything before the last MaxCorpses goes
+		if (Corpses.Num() > Settings.MaxCorpses || Now - Corpse.DeathTime > Settings.CorpseLifetime)
+		{
+			RemoveAt(Index);
+			Pawn->DestroyAfterDeath();
+			INC_DWORD_STAT(STAT_AI_CorpsesRemoved);
+			continue;
+		}
+
+		if (!Corpse.bFrozen && (Now >= Corpse.FreezeTime || (Corpse.bRagdoll && Pawn->IsRagdollSettled(Settings.SettleSpeed))))
+		{
+			Pawn->FreezeCorpse();
+			Corpse.bFrozen = true;
+			if (Corpse.bRagdoll)
+				NumSimulating--;
+
+			INC_DWORD_STAT(STAT_AI_CorpsesFrozen);
+		}
+
+		Index++;
+	}
+
+	SET_DWORD_STAT(STAT_AI_NumCorpses, Corpses.Num());
+	SET_DWORD_STAT(STAT_AI_RagdollsSimulating, NumSimulating);
+}
+
+bool FAI_CorpseManager::Contains(const AAI_PawnBase* Pawn) const
+{
+	return Corpses.ContainsByPredicate([Pawn](const FCorpse& Corpse) { return Corpse.Pawn.Get() == Pawn; });
+}
+
+void FAI_CorpseManager::Reset()
+{
+	Corpses.Reset();
+	NumSimulating = 0;
+}
+
+void FAI_CorpseManager::RemoveAt(const int32 Index)
+{
+	if (Corpses[Index].bRagdoll && !Corpses[Index].bFrozen)
+		NumSimulating--;
+
+	// Keeps the order, the oldest stay at the front
+	Corpses.RemoveAt(Index, 1, false);
+}
@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI_CorpseManager.generated.h"
+
+class AAI_PawnBase;
+
+/**
+ * How many dead AI may ragdoll and stay in the level
+ */
+USTRUCT(BlueprintType)
+struct FAI_CorpseSettings
+{
+	GENERATED_BODY()
+
+	// Ragdolls simulating at once, further deaths play a death animation instead
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 MaxRagdolls = 8;
+
+	// Corpses in the level, the oldest are removed first past this
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 MaxCorpses = 24;
+
+	// Seconds before a corpse is removed
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0, Units = "s"))
+	float CorpseLifetime = 10.f;
+
+	// A ragdoll slower than this is settled and frozen
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float SettleSpeed = 50.f;
+
+	// A ragdoll is frozen after this long even if it never settles
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0, Units = "s"))
+	float MaxRagdollTime = 4.f;
+};
+
+/**
+ * Tracks the dead AI of the level, oldest first
+ * Hands out the ragdoll budget, freezes settled corpses into a static pose and removes the oldest past the cap
+ * Game Thread only
+ */
+class FAI_CorpseManager
+{
+public:
+	// Tracks a dying AI, returns true if it should ragdoll and false if it should play its death animation
+	// An AI without a death animation always ragdolls, even over budget
+	bool Add(AAI_PawnBase* Pawn, float Now, float AnimationLength, const FAI_CorpseSettings& Settings);
+
+	// Freezes settled corpses and removes the oldest and expired ones
+	void Update(float Now, const FAI_CorpseSettings& Settings);
+
+	bool Contains(const AAI_PawnBase* Pawn) const;
+
+	// Forgets every corpse, they are left as they are
+	void Reset();
+
+	FORCEINLINE int32 NumRagdolls() const { return NumSimulating; }
+
+private:
+	struct FCorpse
+	{
+		TWeakObjectPtr<AAI_PawnBase> Pawn;
+		float DeathTime = 0.f;
+		// Death animations are frozen once they reach their last pose
+		float FreezeTime = 0.f;
+		bool bRagdoll = false;
+		bool bFrozen = false;
+	};
+
+	void RemoveAt(int32 Index);
+
+	TArray<FCorpse> Corpses;
+	int32 NumSimulating = 0;
+};
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_Importance.h"
+
+float AI_Importance::DefaultScore(const FAI_ImportanceInputs& Inputs, const FAI_ImportanceWeights& Weights)
+{
+	// 1 at the viewpoint, 0.5 at DistanceFalloff, towards 0 far away
+	const float Distance = FMath::Sqrt(Inputs.DistanceSquared);
+	float Score = Weights.DistanceWeight / (1.f + Distance / Weights.DistanceFalloff);
+
+	if (Inputs.bInView)
+		Score += Weights.InViewWeight;
+
+	if (Inputs.bRecentlyRendered)
+		Score += Weights.RenderedWeight;
+
+	if (Inputs.bHasKnownHostiles)
+		Score += Weights.KnownHostilesWeight;
+
+	switch (Inputs.State)
+	{
+	case EAI_ImportanceState::Search:
+		Score += Weights.SearchStateWeight;
+		break;
+	case EAI_ImportanceState::Destroy:
+		Score += Weights.DestroyStateWeight;
+		break;
+	default:
+		break;
+	}
+
+	return Score;
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI_Importance.generated.h"
+
+// What the AI is doing, as far as its LOD importance is concerned
+namespace EAI_ImportanceState
+{
+	enum EType : uint8
+	{
+		Other,
+		Search,
+		Destroy
+	};
+}
+
+/**
+ * Weights for the default importance function, set per map on the Level Controller
+ * Every term is between 0 and 1 before it is weighted, a higher score is more important
+ */
+USTRUCT(BlueprintType)
+struct FAI_ImportanceWeights
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float DistanceWeight = 1.f;
+
+	// Distance where the distance term has dropped to half
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 1))
+	float DistanceFalloff = 1500.f;
+
+	// AI inside the viewpoint's frustum
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float InViewWeight = 0.5f;
+
+	// AI whose mesh was rendered recently, so not occluded
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float RenderedWeight = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float SearchStateWeight = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float DestroyStateWeight = 2.f;
+
+	// AI that can currently see a hostile
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float KnownHostilesWeight = 1.f;
+};
+
+// Everything an importance function may look at for one AI, filled from the snapshot
+struct FAI_ImportanceInputs
+{
+	float DistanceSquared = 0.f;
+	bool bInView = false;
+	bool bRecentlyRendered = false;
+	bool bHasKnownHostiles = false;
+	EAI_ImportanceState::EType State = EAI_ImportanceState::Other;
+};
+
+/**
+ * Scores one AI, runs on worker threads so it may only use its arguments
+ */
+using FAI_ImportanceFunction = TFunction<float(const FAI_ImportanceInputs&, const FAI_ImportanceWeights&)>;
+
+namespace AI_Importance
+{
+	// Weighted sum of distance, view, rendering, state and known hostile terms
+	float DefaultScore(const FAI_ImportanceInputs& Inputs, const FAI_ImportanceWeights& Weights);
+}
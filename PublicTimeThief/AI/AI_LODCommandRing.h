@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+#include <atomic>
+
+namespace EAI_LODCommand
+{
+	enum EType : uint8
+	{
+		Thinking,
+		Rendering
+	};
+}
+
+/**
+ * A single LOD transition sent from the LOD pass to the game thread
+ */
+struct FAI_LODCommand
+{
+	// Resolved on the game thread, a stale handle means the AI is gone and the command is dropped
+	FAI_PawnHandle Handle;
+
+	EAI_LODCommand::EType Type = EAI_LODCommand::Thinking;
+	TEnumAsByte<EControllerStatus::EType> Status = EControllerStatus::None;
+	bool bRender = false;
+
+	// Lower is applied first
+	float Priority = 0.f;
+};
+
+/**
+ * Bounded single producer, single consumer ring
+ * Push is only called from the producer thread and Pop only from the consumer thread, neither ever blocks
+ */
+template<typename ItemType, uint32 Capacity>
+class TAI_SpscRing
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "TAI_SpscRing Capacity must be a power of two");
+
+public:
+	// Producer: returns false if the ring is full
+	bool Push(const ItemType& Item)
+	{
+		const uint32 CurrentTail = Tail.load(std::memory_order_relaxed);
+		if (CurrentTail - Head.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		Items[CurrentTail & (Capacity - 1)] = Item;
+		Tail.store(CurrentTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer: returns false if the ring is empty
+	bool Pop(ItemType& OutItem)
+	{
+		const uint32 CurrentHead = Head.load(std::memory_order_relaxed);
+		if (CurrentHead == Tail.load(std::memory_order_acquire))
+			return false;
+
+		OutItem = Items[CurrentHead & (Capacity - 1)];
+		Head.store(CurrentHead + 1, std::memory_order_release);
+		return true;
+	}
+
+	uint32 Num() const
+	{
+		return Tail.load(std::memory_order_acquire) - Head.load(std::memory_order_acquire);
+	}
+
+private:
+	// Head is only written by the consumer and Tail only by the producer, kept on separate cache lines
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> Head{ 0 };
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> Tail{ 0 };
+
+	alignas(PLATFORM_CACHE_LINE_SIZE) ItemType Items[Capacity];
+};
+
+using FAI_LODCommandRing = TAI_SpscRing<FAI_LODCommand, 1024>;
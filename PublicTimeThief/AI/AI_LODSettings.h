@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI_Importance.h"
+#include "AI_LODSettings.generated.h"
+
+/**
+ * Hysteresis for one LOD tier, an AI enters the tier inside EnterDistance and leaves it past ExitDistance
+ */
+USTRUCT(BlueprintType)
+struct FAI_LODBand
+{
+	GENERATED_BODY()
+
+	// Distance an AI must come within to be promoted into this tier
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float EnterDistance = 4750.f;
+
+	// Distance an AI must pass to be demoted out of this tier, should be >= EnterDistance
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float ExitDistance = 5250.f;
+
+	// Ranks an AI already in this tier may fall past the tier's count before it is demoted
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 RankSlack = 2;
+
+	// Seconds an AI must stay in this tier before it can be demoted
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MinDwellTime = 2.f;
+};
+
+/**
+ * How cheaply the skeletal meshes of a rendered AI in one tier animate
+ */
+USTRUCT(BlueprintType)
+struct FAI_AnimationTier
+{
+	GENERATED_BODY()
+
+	FAI_AnimationTier() = default;
+	FAI_AnimationTier(const int32 InFrameSkip, const int32 InMinLOD, const bool bInInterpolate, const bool bInOnlyTickPoseWhenRendered)
+		: FrameSkip(InFrameSkip), MinLOD(InMinLOD), bInterpolateSkippedFrames(bInInterpolate), bOnlyTickPoseWhenRendered(bInOnlyTickPoseWhenRendered)
+	{
+	}
+
+	// Frames skipped between animation updates, 0 updates every frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0, ClampMax = 15))
+	int32 FrameSkip = 0;
+
+	// Lowest mesh LOD used, higher LODs have fewer bones to evaluate
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 MinLOD = 0;
+
+	// Blend between updates instead of stepping, costs a little per skipped frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bInterpolateSkippedFrames = true;
+
+	// Skip the pose entirely while the mesh is off screen
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bOnlyTickPoseWhenRendered = true;
+};
+
+/**
+ * Caps the animation work of every rendered AI together
+ * Cost is counted in full rate updates, an AI skipping N frames counts 1 / (N + 1)
+ */
+USTRUCT(BlueprintType)
+struct FAI_AnimationBudget
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bEnabled = true;
+
+	// Full rate animation updates per frame all AI may use together
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 1))
+	float MaxFullRateUpdates = 16.f;
+
+	// Frames the budget may add to the FrameSkip of every tier but Normal
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0, ClampMax = 15))
+	int32 MaxExtraFrameSkip = 4;
+
+	// Seconds between budget checks, every AI whose skip changes is updated then
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.05, Units = "s"))
+	float AdjustInterval = 0.5f;
+};
+
+/**
+ * Render cost of AI by distance to the closest viewpoint and whether any viewpoint can see them
+ */
+USTRUCT(BlueprintType)
+struct FAI_RenderCostSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bEnabled = true;
+
+	// AI in view and closer than this cast dynamic shadows
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float ShadowDistance = 2500.f;
+
+	// AI in view and closer than this pick their mesh LOD as usual, others use ReducedLOD
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float FullDetailDistance = 3000.f;
+
+	// Mesh LOD forced on AI that are far or out of view
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 ReducedLOD = 2;
+
+	// AI in view and closer than this show their Sword or Gun
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float WeaponDistance = 4000.f;
+
+	// Seconds between checks of every AI's render cost
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.05, Units = "s"))
+	float UpdateInterval = 0.25f;
+
+	// Render cost changes applied per frame, the rest wait, a newer change replaces a waiting one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 1))
+	int32 MaxChangesPerTick = 16;
+};
+
+// Limits the LOD pass ranks the AI with, published with every snapshot
+struct FAI_LODSettings
+{
+	int32 NumOfThinkingCharacters = 0;
+	int32 NumOfIntelligentCharacters = 0;
+
+	FAI_LODBand IntelligentBand;
+	FAI_LODBand ThinkingBand;
+	FAI_LODBand RenderingBand;
+
+	FAI_ImportanceWeights ImportanceWeights;
+
+	// Pause animations of AI outside every viewpoint's frustum
+	bool bPauseAnimationOutOfView = true;
+	// AI closer than this to a viewpoint keep animating even out of view
+	float OutOfViewAnimationDistance = 600.f;
+	// Radius added around the AI for the frustum test
+	float FrustumPadding = 150.f;
+};
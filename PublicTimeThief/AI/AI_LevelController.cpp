@@ -2,232 +2,350 @@
 
 
 #include "AI_LevelController.h"
-#include "ProjectTimeThief/AI/Spawners/SpawnerController.h"
+#include "AI_SpawnerBase.h"
+#include "ProjectTimeThief/AI/Brain/AI_ControllerBase.h"
+#include "ProjectTimeThief/AI/Brain/AI_StateManager.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "Camera/CameraComponent.h"
 #include "Kismet/GameplayStatics.h"
+#include "RenderCore.h"
+#include <algorithm>
 
-/**
- * @param PlayerPtr Player Pointer
- * @param AllActors Addresses of the AI Characters to look at
- * @param DefaultNumOfThinkingCharacters Number of AI Characters that should be thinking when closest to the Player
- * @param DefaultNumOfIntelligentCharacters Number of AI Characters that should be Intelligent when closest to the Player
- * @param TooFarAwayDistance Distance that the AI is too far away to render or think
- */
-FAI_LevelControllerThread::FAI_LevelControllerThread(APawn* PlayerPtr, TArray<AAI_PawnBase*> AllActors,
-	int DefaultNumOfThinkingCharacters, int DefaultNumOfIntelligentCharacters, float TooFarAwayDistance)
-{
-	Player = PlayerPtr;
-	for(AAI_PawnBase* Character : AllActors)
-		CharacterSet.Emplace(Character);
-	
-	NumOfThinkingCharacters = DefaultNumOfThinkingCharacters;
-	NumOfIntelligentCharacters = DefaultNumOfIntelligentCharacters;
-	TooFarAway = TooFarAwayDistance;
-}
+DECLARE_CYCLE_STAT(TEXT("AI Level Controller LOD Pass"), STAT_AI_LevelControllerLODPass, STATGROUP_TimeThiefAI);
+DECLARE_CYCLE_STAT(TEXT("AI Level Controller Publish Snapshot"), STAT_AI_LevelControllerPublish, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Commands Overflowed"), STAT_AI_LODCommandsOverflowed, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Commands Coalesced"), STAT_AI_LODCommandsCoalesced, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("LOD Commands Waiting"), STAT_AI_LODCommandsWaiting, STATGROUP_TimeThiefAI);
+DECLARE_CYCLE_STAT(TEXT("AI Level Controller Apply Transitions"), STAT_AI_LevelControllerApply, STATGROUP_TimeThiefAI);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Population Budget Level"), STAT_AI_PopulationBudgetLevel, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Budget Thinking Characters"), STAT_AI_BudgetThinkingCharacters, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Budget Intelligent Characters"), STAT_AI_BudgetIntelligentCharacters, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pawn Pool Hits"), STAT_AI_PawnPoolHits, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pawn Pool Misses"), STAT_AI_PawnPoolMisses, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Pawns"), STAT_AI_PooledPawns, STATGROUP_TimeThiefAI);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("LOD Transitions Per Second"), STAT_AI_LODTransitionsPerSecond, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI Physics Bodies"), STAT_AI_PhysicsBodies, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI Physics Sleeping"), STAT_AI_PhysicsSleeping, STATGROUP_TimeThiefAI);
+DECLARE_CYCLE_STAT(TEXT("AI Render Cost"), STAT_AI_RenderCost, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Render Cost Changes"), STAT_AI_RenderCostChanges, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Render Cost Changes Waiting"), STAT_AI_RenderCostWaiting, STATGROUP_TimeThiefAI);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Animation Budget Load"), STAT_AI_AnimationBudgetLoad, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Animation Extra Frame Skip"), STAT_AI_AnimationExtraFrameSkip, STATGROUP_TimeThiefAI);
 
+// Smallest chunk of AI handed to a ParallelFor worker
+static constexpr int32 LODMinBatchSize = 64;
 
-bool FAI_LevelControllerThread::Init()
+void FAI_LODEvaluator::Run()
 {
-	bStopThread = false;
-	return true;
+	const FAI_LevelSnapshot* Snapshot = LevelController->SnapshotBuffer.Acquire();
+
+	// Nothing new since the last pass
+	if (Snapshot == nullptr || Snapshot->Version == LastSnapshotVersion)
+	{
+		LevelController->SnapshotBuffer.Release();
+		return;
+	}
+
+	LastSnapshotVersion = Snapshot->Version;
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	Evaluate(*Snapshot);
+	LevelController->LODPassCycles.store(FPlatformTime::Cycles() - StartCycles, std::memory_order_relaxed);
+
+	LevelController->SnapshotBuffer.Release();
 }
 
-uint32 FAI_LevelControllerThread::Run()
+void FAI_LODEvaluator::Evaluate(const FAI_LevelSnapshot& Snapshot)
 {
-	while(!bStopThread)
+	SCOPE_CYCLE_COUNTER(STAT_AI_LevelControllerLODPass);
+
+	if (Snapshot.Viewpoints.IsEmpty() || Snapshot.Num() == 0)
+		return;
+
+	ResizeArrays(Snapshot.Num());
+
+	const int32 NumRanked = GatherScores(Snapshot);
+
+	const FAI_LODSettings& Settings = Snapshot.Settings;
+	const int32 ThinkingCount = FMath::Clamp(Settings.NumOfThinkingCharacters, 0, NumRanked);
+	const int32 IntelligentCount = FMath::Clamp(Settings.NumOfIntelligentCharacters, 0, ThinkingCount);
+
+	// Each tier's count and its slack must split the most important AI from the rest
+	int32 Boundaries[] = {
+		IntelligentCount,
+		FMath::Min(IntelligentCount + Settings.IntelligentBand.RankSlack, NumRanked),
+		ThinkingCount,
+		FMath::Min(ThinkingCount + Settings.ThinkingBand.RankSlack, NumRanked)
+	};
+	Algo::Sort(Boundaries);
+	SelectMostImportant(NumRanked, Boundaries);
+
+	// Each Rank is independent so it can be split across workers
+	ParallelFor(TEXT("AI LOD Tiers"), NumRanked, LODMinBatchSize, [this, &Snapshot, ThinkingCount, IntelligentCount](const int32 Rank)
+		{
+			DecideTier(Snapshot, Rank, ThinkingCount, IntelligentCount);
+		});
+
+	for (int32 Rank = 0; Rank < NumRanked; Rank++)
 	{
-		// Handle All Queues
-		AddActorsToCharacterSet();
-		RemoveActorsFromCharacterSet();
-		DestroyFromQueue();
-		RemoveDeadActors();
+		const int32 Slot = RankOrder[Rank];
 
-		TArray<AAI_PawnBase*> Characters = CharacterSet.Array();
+		RequestThinkingStatus(Snapshot, Slot, DesiredStatus[Slot]);
+		RequestRenderingStatus(Snapshot, Slot, static_cast<bool>(DesiredRendering[Slot]));
+	}
+}
 
-		Algo::Sort(Characters, [this](const AAI_PawnBase* Lhs, const AAI_PawnBase* Rhs)
-			{
-				if (Lhs == nullptr || Rhs == nullptr)
-					return false;
+void FAI_LODEvaluator::ResizeArrays(const int32 NumSlots)
+{
+	// Keeps the allocations, so this only allocates when the registry grows past its peak
+	DistancesSquared.SetNumUninitialized(NumSlots, false);
+	Scores.SetNumUninitialized(NumSlots, false);
+	InViewFlags.SetNumUninitialized(NumSlots, false);
+	RankOrder.SetNumUninitialized(NumSlots, false);
+	DesiredStatus.SetNumUninitialized(NumSlots, false);
+	DesiredRendering.SetNumUninitialized(NumSlots, false);
 
-				const FVector PlayerLocation = Player->GetActorLocation();
-				return FVector::Dist(PlayerLocation, Lhs->GetActorLocation()) < FVector::Dist(PlayerLocation, Rhs->GetActorLocation());
-			});
+	// New slots start with nothing pending
+	PendingState.SetNumZeroed(NumSlots, false);
+	PendingVersion.SetNumZeroed(NumSlots, false);
+	PendingOwner.SetNumZeroed(NumSlots, false);
+	SeenStatus.SetNumZeroed(NumSlots, false);
+	SeenRendering.SetNumZeroed(NumSlots, false);
+	StatusSince.SetNumZeroed(NumSlots, false);
+	RenderingSince.SetNumZeroed(NumSlots, false);
+}
 
-		int CharacterCount = 0;
+/**
+ * Each AI is scored against every viewpoint and keeps its best score, its distance is to the closest
+ * viewpoint and it is in view if any viewpoint's frustum contains it
+ */
+int32 FAI_LODEvaluator::GatherScores(const FAI_LevelSnapshot& Snapshot)
+{
+	const FAI_ImportanceWeights& Weights = Snapshot.Settings.ImportanceWeights;
+	const float FrustumPadding = Snapshot.Settings.FrustumPadding;
 
-		for(AAI_PawnBase* Character : Characters)
+	ParallelFor(TEXT("AI LOD Scores"), Snapshot.Num(), LODMinBatchSize, [this, &Snapshot, &Weights, FrustumPadding](const int32 Slot)
 		{
-			if (!IsValid(Character))
-				continue;
+			DistancesSquared[Slot] = MAX_flt;
+			Scores[Slot] = -MAX_flt;
+			InViewFlags[Slot] = false;
 
-			if(Character->bIsDead)
-			{
-				DeadActorQueue.Enqueue(Character);
-				continue;
-			}
+			if (!Snapshot.AliveFlags[Slot])
+				return;
 
-			const FVector PlayerLocation = Player->GetActorLocation();
+			const FVector& Position = Snapshot.Positions[Slot];
 
-			if(CharacterCount < NumOfThinkingCharacters && FVector::Dist(PlayerLocation, Character->GetActorLocation()) < TooFarAway)
-			{
-				if(CharacterCount < NumOfIntelligentCharacters)
-				{
-					if(Character->GetControllerStatus() != EControllerStatus::Normal && LevelController->Mutex.TryLock())
-					{
-						// Enable Intelligent Thinking
-						if(!LevelController->EnableThinkMap.Contains(Character))
-						{
-							LevelController->EnableThinkQueue.Enqueue(Character);
-							LevelController->EnableThinkMap.Add(Character, EControllerStatus::Normal);
-						}
-						LevelController->Mutex.Unlock();
-					}
-				}
-				else
-				{
-					if(Character->GetControllerStatus() != EControllerStatus::Basic && LevelController->Mutex.TryLock())
-					{
-						// Enable Basic Thinking
-						if(!LevelController->EnableThinkMap.Contains(Character))
-						{
-							LevelController->EnableThinkQueue.Enqueue(Character);
-							LevelController->EnableThinkMap.Add(Character, EControllerStatus::Basic);
-						}
-						LevelController->Mutex.Unlock();
-					}
-				}
-
-				// If Rendering Is Off Turn It Back On
-				if(Character->IsRendering() == false && LevelController->Mutex.TryLock())
-				{
-					// Resume Rendering
-					if(!LevelController->EnableRenderSet.Contains(Character))
-					{
-						LevelController->EnableRenderQueue.Enqueue(Character);
-						LevelController->EnableRenderSet.Add(Character);
-					}
-					LevelController->Mutex.Unlock();
-				}
-			}
-			else
+			FAI_ImportanceInputs Inputs;
+			Inputs.bRecentlyRendered = Snapshot.RecentlyRenderedFlags[Slot] != 0;
+			Inputs.bHasKnownHostiles = Snapshot.KnownHostileFlags[Slot] != 0;
+			Inputs.State = Snapshot.ImportanceStates[Slot];
+
+			for (const FAI_Viewpoint& Viewpoint : Snapshot.Viewpoints)
 			{
-				// Disable Thinking
-				if(Character->GetControllerStatus() != EControllerStatus::Sleep)
-				{
-					Character->SetEnableThinking(false);
-
-					if (LevelController->Mutex.TryLock())
-					{
-						if(!LevelController->DisableThinkSet.Contains(Character))
-						{
-							LevelController->DisableThinkQueue.Enqueue(Character);
-							LevelController->DisableThinkSet.Add(Character);
-						}
-						LevelController->Mutex.Unlock();
-					}
-				}
-
-				// If AI is too far away from Player, then stop rendering(Anims, etc.)
-				if(FVector::Dist(Player->GetActorLocation(), Character->GetActorLocation()) > TooFarAway)
-				{
-					// Stop Rendering
-					if(Character->IsRendering() == true && LevelController->Mutex.TryLock())
-					{
-						if(!LevelController->DisableRenderSet.Contains(Character))
-						{
-							LevelController->DisableRenderQueue.Enqueue(Character);
-							LevelController->DisableRenderSet.Add(Character);
-						}
-						LevelController->Mutex.Unlock();
-					}
-				}
-				else if(Character->IsRendering() == false && LevelController->Mutex.TryLock())
-				{
-					// Resume Rendering if it's off
-					if(LevelController->EnableRenderSet.Contains(Character))
-					{
-						LevelController->EnableRenderQueue.Enqueue(Character);
-						LevelController->EnableRenderSet.Add(Character);
-					}
-					LevelController->Mutex.Unlock();
-				}
+				Inputs.DistanceSquared = FVector::DistSquared(Viewpoint.Location, Position);
+				Inputs.bInView = Viewpoint.IsInFrustum(Position, FrustumPadding);
+
+				const float Score = Snapshot.ImportanceFunction.IsValid()
+					? (*Snapshot.ImportanceFunction)(Inputs, Weights)
+					: AI_Importance::DefaultScore(Inputs, Weights);
+
+				Scores[Slot] = FMath::Max(Scores[Slot], Score);
+				DistancesSquared[Slot] = FMath::Min(DistancesSquared[Slot], Inputs.DistanceSquared);
+				InViewFlags[Slot] |= Inputs.bInView;
 			}
-			CharacterCount++;
-		}
+		});
+
+	// Only alive AI are ranked
+	int32 NumRanked = 0;
+	for (int32 Slot = 0; Slot < Snapshot.Num(); Slot++)
+	{
+		if (Snapshot.AliveFlags[Slot])
+			RankOrder[NumRanked++] = Slot;
 	}
-	return 0;
+	return NumRanked;
 }
 
-void FAI_LevelControllerThread::Stop()
+/**
+ * Only the boundaries matter, so starting from the furthest boundary the most important AI are moved
+ * in front of it (unordered), then the next boundary only has to look at that front range
+ */
+void FAI_LODEvaluator::SelectMostImportant(const int32 NumRanked, const TConstArrayView<int32> Boundaries)
 {
-	if(LevelController->CurrentThread)
+	auto ByImportance = [this](const int32 Lhs, const int32 Rhs)
+		{
+			return Scores[Lhs] > Scores[Rhs];
+		};
+
+	int32* First = RankOrder.GetData();
+	int32 End = NumRanked;
+
+	for (int32 Index = Boundaries.Num() - 1; Index >= 0; Index--)
 	{
-		LevelController->CurrentThread->WaitForCompletion();
+		const int32 Boundary = Boundaries[Index];
+		if (Boundary > 0 && Boundary < End)
+		{
+			std::nth_element(First, First + Boundary, First + End, ByImportance);
+			End = Boundary;
+		}
 	}
 }
 
-void FAI_LevelControllerThread::AddAIToPool(AAI_PawnBase* Character)
+/**
+ * Promotions use the tier's EnterDistance and count, AI already in the tier use the ExitDistance
+ * and count + RankSlack, and a demotion waits until the AI has been in its tier for MinDwellTime
+ */
+void FAI_LODEvaluator::DecideTier(const FAI_LevelSnapshot& Snapshot, const int32 Rank,
+	const int32 ThinkingCount, const int32 IntelligentCount)
 {
-	Mutex.Lock();
-	AddActorQueue.Enqueue(Character);
-	Mutex.Unlock();
-}
+	const int32 Slot = RankOrder[Rank];
+	UpdateSlotState(Snapshot, Slot);
 
-void FAI_LevelControllerThread::RemoveAIFromPool(AAI_PawnBase* RemoveActor)
-{
-	RemoveActorQueue.Enqueue(RemoveActor);
-}
+	const float DistanceSquared = DistancesSquared[Slot];
+	const TEnumAsByte<EControllerStatus::EType> Current = Snapshot.Statuses[Slot];
+	const FAI_LODSettings& Settings = Snapshot.Settings;
+	const FAI_LODBand& Intelligent = Settings.IntelligentBand;
+	const FAI_LODBand& Thinking = Settings.ThinkingBand;
+	const FAI_LODBand& Rendering = Settings.RenderingBand;
 
-void FAI_LevelControllerThread::AddActorsToCharacterSet()
-{
-	while(!AddActorQueue.IsEmpty())
+	const bool bIntelligent = Current == EControllerStatus::Normal
+		? Rank < IntelligentCount + Intelligent.RankSlack && DistanceSquared < FMath::Square(Intelligent.ExitDistance)
+		: Rank < IntelligentCount && DistanceSquared < FMath::Square(Intelligent.EnterDistance);
+
+	const bool bThinking = Current == EControllerStatus::Normal || Current == EControllerStatus::Basic
+		? Rank < ThinkingCount + Thinking.RankSlack && DistanceSquared < FMath::Square(Thinking.ExitDistance)
+		: Rank < ThinkingCount && DistanceSquared < FMath::Square(Thinking.EnterDistance);
+
+	TEnumAsByte<EControllerStatus::EType> Desired = EControllerStatus::Sleep;
+	if (bThinking)
+		Desired = bIntelligent ? EControllerStatus::Normal : EControllerStatus::Basic;
+
+	// Sleep < Basic < Normal, so a lower Status is a demotion
+	if (Desired < Current)
 	{
-		AAI_PawnBase* OutCharacter;
-		AddActorQueue.Dequeue(OutCharacter);
+		const float MinDwellTime = Current == EControllerStatus::Normal ? Intelligent.MinDwellTime : Thinking.MinDwellTime;
+		if (Snapshot.WorldTime - StatusSince[Slot] < MinDwellTime)
+			Desired = Current;
+	}
+	DesiredStatus[Slot] = Desired;
 
-		if (!CharacterSet.Contains(OutCharacter))
-		{
-			CharacterSet.Emplace(OutCharacter);
-		}
+	// If AI is too far away from every viewpoint, then stop rendering(Anims, etc.)
+	const bool bWasRendering = static_cast<bool>(Snapshot.RenderingFlags[Slot]);
+	bool bRender = DistanceSquared < FMath::Square(bWasRendering ? Rendering.ExitDistance : Rendering.EnterDistance);
+
+	// Close AI outside every frustum can't be seen either, unless they are close enough to turn around to
+	if (bRender && Settings.bPauseAnimationOutOfView && !InViewFlags[Slot]
+		&& DistanceSquared >= FMath::Square(Settings.OutOfViewAnimationDistance))
+	{
+		bRender = false;
 	}
+
+	if (bWasRendering && !bRender && Snapshot.WorldTime - RenderingSince[Slot] < Rendering.MinDwellTime)
+		bRender = true;
+
+	DesiredRendering[Slot] = bRender;
 }
 
-void FAI_LevelControllerThread::RemoveActorsFromCharacterSet()
+void FAI_LODEvaluator::UpdateSlotState(const FAI_LevelSnapshot& Snapshot, const int32 Slot)
 {
-	while (!RemoveActorQueue.IsEmpty())
+	uint8& Pending = PendingState[Slot];
+
+	// Slot was reused by another AI, it starts dwelling in whatever tier it is in now
+	if (PendingOwner[Slot] != Snapshot.Handles[Slot])
 	{
-		AAI_PawnBase* OutCharacter;
-		RemoveActorQueue.Dequeue(OutCharacter);
+		PendingOwner[Slot] = Snapshot.Handles[Slot];
+		Pending = 0;
 
-		if (CharacterSet.Contains(OutCharacter))
-		{
-			CharacterSet.Remove(OutCharacter);
-			DestroyQueue.Enqueue(OutCharacter);
-		}
+		SeenStatus[Slot] = Snapshot.Statuses[Slot];
+		SeenRendering[Slot] = Snapshot.RenderingFlags[Slot];
+		StatusSince[Slot] = Snapshot.WorldTime;
+		RenderingSince[Slot] = Snapshot.WorldTime;
+		return;
 	}
+
+	if (SeenStatus[Slot] != Snapshot.Statuses[Slot])
+	{
+		SeenStatus[Slot] = Snapshot.Statuses[Slot];
+		StatusSince[Slot] = Snapshot.WorldTime;
+	}
+
+	if (SeenRendering[Slot] != Snapshot.RenderingFlags[Slot])
+	{
+		SeenRendering[Slot] = Snapshot.RenderingFlags[Slot];
+		RenderingSince[Slot] = Snapshot.WorldTime;
+	}
+
+	// The game thread has applied the transition
+	if ((Pending & PendingThinking) && (Pending & PendingStatusMask) == Snapshot.Statuses[Slot])
+		Pending &= ~(PendingThinking | PendingStatusMask);
+
+	if ((Pending & PendingRendering) && static_cast<bool>(Pending & PendingRenderOn) == static_cast<bool>(Snapshot.RenderingFlags[Slot]))
+		Pending &= ~(PendingRendering | PendingRenderOn);
+
+	// Never applied (AI had no controller, etc.), allow it to be sent again
+	if (Pending != 0 && Snapshot.Version - PendingVersion[Slot] > PendingRetryVersions)
+		Pending = 0;
 }
 
-void FAI_LevelControllerThread::DestroyFromQueue()
+void FAI_LODEvaluator::RequestThinkingStatus(const FAI_LevelSnapshot& Snapshot, const int32 Slot,
+	const TEnumAsByte<EControllerStatus::EType> Status)
 {
-	//uint8 Counter = DestroyPerTick;
-	while(!DestroyQueue.IsEmpty())
+	uint8& Pending = PendingState[Slot];
+	const bool bPending = (Pending & PendingThinking) != 0;
+
+	// Compare against what the AI will be once pending commands are applied
+	const uint8 ExpectedStatus = bPending ? (Pending & PendingStatusMask) : static_cast<uint8>(Snapshot.Statuses[Slot]);
+	if (ExpectedStatus == Status)
 	{
-		if(AAI_PawnBase* Pawn; DestroyQueue.Dequeue(Pawn))
-		{
-			SpawnerController->DespawnRequests.Enqueue(Pawn);
-		}
+		if (bPending)
+			LevelController->CommandCoalescedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
 	}
+
+	FAI_LODCommand Command;
+	Command.Handle = Snapshot.Handles[Slot];
+	Command.Type = EAI_LODCommand::Thinking;
+	Command.Status = Status;
+	Command.Priority = -Scores[Slot];
+
+	// Not marked as pending, so it is sent again next pass
+	if (!LevelController->CommandRing.Push(Command))
+	{
+		LevelController->CommandOverflowCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Pending = (Pending & ~PendingStatusMask) | PendingThinking | (Status & PendingStatusMask);
+	PendingVersion[Slot] = Snapshot.Version;
 }
 
-void FAI_LevelControllerThread::RemoveDeadActors()
+void FAI_LODEvaluator::RequestRenderingStatus(const FAI_LevelSnapshot& Snapshot, const int32 Slot, const bool bRender)
 {
-	while(!DeadActorQueue.IsEmpty())
+	uint8& Pending = PendingState[Slot];
+	const bool bPending = (Pending & PendingRendering) != 0;
+
+	const bool bExpectedRender = bPending ? (Pending & PendingRenderOn) != 0 : static_cast<bool>(Snapshot.RenderingFlags[Slot]);
+	if (bExpectedRender == bRender)
 	{
-		if(AAI_PawnBase* Pawn; DeadActorQueue.Dequeue(Pawn) && CharacterSet.Contains(Pawn))
-		{
-			CharacterSet.Remove(Pawn);
-			LevelController->DestroyQueue.Enqueue(Pawn);
-		}
+		if (bPending)
+			LevelController->CommandCoalescedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
 	}
+
+	FAI_LODCommand Command;
+	Command.Handle = Snapshot.Handles[Slot];
+	Command.Type = EAI_LODCommand::Rendering;
+	Command.bRender = bRender;
+	Command.Priority = -Scores[Slot];
+
+	if (!LevelController->CommandRing.Push(Command))
+	{
+		LevelController->CommandOverflowCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Pending = (Pending & ~PendingRenderOn) | PendingRendering | (bRender ? PendingRenderOn : 0);
+	PendingVersion[Slot] = Snapshot.Version;
 }
 
 // Sets default values
@@ -236,6 +354,13 @@ AAI_LevelController::AAI_LevelController()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	// After movement so the snapshot has this frame's positions, and nothing is evaluated while paused
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+	PrimaryActorTick.bTickEvenWhenPaused = false;
+
+	// Animations are cheaper to flip than thinking, so they do not need as much slack
+	RenderingBand.RankSlack = 0;
+	RenderingBand.MinDwellTime = 1.f;
 }
 
 // Called when the game starts or when spawned
@@ -243,126 +368,905 @@ void AAI_LevelController::BeginPlay()
 {
 	Super::BeginPlay();
 
-	APawn* PlayerPtr = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
-
 	TArray<AActor*> OutActors;
 	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AAI_PawnBase::StaticClass(), OutActors);
 
-	TArray<AAI_PawnBase*> Characters;
+	PawnRegistry.Reserve(OutActors.Num());
 	for(AActor* Actor : OutActors)
 	{
-		if (AAI_PawnBase* Character = Cast<AAI_PawnBase>(Actor); IsValid(Character))
-			Characters.Add(Character);
+		// Pooled AI are registered when they are handed out
+		if (AAI_PawnBase* Character = Cast<AAI_PawnBase>(Actor); IsValid(Character) && !Character->IsInPool())
+			RegisterPawn(Character);
 	}
 
-	LevelControllerThread = new FAI_LevelControllerThread(PlayerPtr, Characters, NumberOfThinkingCharacters,
-		NumberOfIntelligentCharacters, TooFarAwayDistance);
+	// Start the budget where the configured counts are, it adapts from there
+	// Both share one level, so it starts at the lower one and neither count is exceeded at first
+	const float ThinkingLevel = FMath::GetRangePct(static_cast<float>(PopulationBudget.MinThinkingCharacters),
+		static_cast<float>(PopulationBudget.MaxThinkingCharacters), static_cast<float>(NumberOfThinkingCharacters));
+	const float IntelligentLevel = FMath::GetRangePct(static_cast<float>(PopulationBudget.MinIntelligentCharacters),
+		static_cast<float>(PopulationBudget.MaxIntelligentCharacters), static_cast<float>(NumberOfIntelligentCharacters));
+	PopulationBudgetController.Reset(FMath::Min(ThinkingLevel, IntelligentLevel));
 
-	LevelControllerThread->LevelController = this;
+	if (!ImportanceFunction.IsValid())
+		SetImportanceFunction(&AI_Importance::DefaultScore);
 
-	TArray<AActor*> OutArray;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), ASpawnerController::StaticClass(), OutArray);
+	LODEvaluator.LevelController = this;
+}
 
-	for (AActor* Actor : OutArray)
-	{
-		LevelControllerThread->SpawnerController = Cast<ASpawnerController>(Actor);
-	}
+void AAI_LevelController::AddAIToThreadPool(AAI_PawnBase* AICharacter)
+{
+	if (IsValid(AICharacter))
+		RegisterPawn(AICharacter);
+}
 
-	CurrentThread = FRunnableThread::Create(LevelControllerThread, TEXT("AI Level Controller Thread"),
-		0, EThreadPriority::TPri_BelowNormal);
+// The AI stays registered and keeps behaving until the scheduler despawns it
+void AAI_LevelController::RemoveAIFromThreadPool(AAI_PawnBase* AICharacter)
+{
+	if (IsValid(AICharacter) && PawnRegistry.Resolve(AICharacter->GetPawnHandle()) == AICharacter)
+		SpawnScheduler.QueueDespawn(AICharacter->GetPawnHandle(), GetWorld()->GetTimeSeconds());
 }
 
-void AAI_LevelController::AddAIToThreadPool(AAI_PawnBase* AICharacter)
+void AAI_LevelController::RegisterSpawner(AAI_SpawnerBase* Spawner)
+{
+	if (IsValid(Spawner))
+		Spawners.AddUnique(Spawner);
+}
+
+void AAI_LevelController::UnregisterSpawner(AAI_SpawnerBase* Spawner)
 {
-	if(CurrentThread && LevelControllerThread)
+	Spawners.RemoveSingleSwap(Spawner);
+}
+
+void AAI_LevelController::UpdateSpawnerActivation(const float DeltaTime)
+{
+	TimeSinceSpawnerActivation += DeltaTime;
+	if (TimeSinceSpawnerActivation < SpawnerActivationInterval || Viewpoints.IsEmpty())
+		return;
+
+	TimeSinceSpawnerActivation = 0.f;
+
+	// Dormant spawners in reach, with their squared distance to the closest viewpoint
+	TArray<TPair<float, AAI_SpawnerBase*>, TInlineAllocator<16>> Candidates;
+
+	for (int32 Index = Spawners.Num() - 1; Index >= 0; Index--)
+	{
+		AAI_SpawnerBase* Spawner = Spawners[Index].Get();
+		if (!IsValid(Spawner) || Spawner->bAllDead)
+		{
+			Spawners.RemoveAtSwap(Index);
+			continue;
+		}
+
+		float DistanceSquared = MAX_flt;
+		for (const FAI_Viewpoint& Viewpoint : Viewpoints)
+			DistanceSquared = FMath::Min(DistanceSquared, FVector::DistSquared(Viewpoint.Location, Spawner->GetActorLocation()));
+
+		if (Spawner->IsFlockActive() && DistanceSquared > FMath::Square(SpawnerDeactivateDistance))
+			Spawner->DeactivateFlock();
+		else if (!Spawner->IsFlockActive() && DistanceSquared < FMath::Square(SpawnerActivateDistance))
+			Candidates.Emplace(DistanceSquared, Spawner);
+	}
+
+	Algo::SortBy(Candidates, [](const TPair<float, AAI_SpawnerBase*>& Candidate) { return Candidate.Key; });
+
+	// Despawns are still waiting in the scheduler, they count against the cap until they are gone
+	int32 LiveCount = PawnRegistry.NumRegistered();
+	for (const TPair<float, AAI_SpawnerBase*>& Candidate : Candidates)
 	{
-		LevelControllerThread->AddAIToPool(AICharacter);
+		AAI_SpawnerBase* Spawner = Candidate.Value;
+		if (MaxLivePawns > 0 && LiveCount + Spawner->GetFlockSize() > MaxLivePawns)
+			break;
+
+		Spawner->ActivateFlock();
+		LiveCount += Spawner->GetFlockSize();
 	}
 }
 
-void AAI_LevelController::RemoveAIFromThreadPool(AAI_PawnBase* AICharacter)
+void AAI_LevelController::QueueSpawn(AAI_SpawnerBase* Spawner, const FVector& Location, const FRotator& Rotation)
+{
+	SpawnScheduler.QueueSpawn(Spawner, Location, Rotation, GetWorld()->GetTimeSeconds());
+}
+
+void AAI_LevelController::DespawnNow(AAI_PawnBase* Pawn)
 {
-	if (CurrentThread && LevelControllerThread)
+	UnregisterPawn(Pawn);
+
+	if (!ReleaseToPool(Pawn))
+		Pawn->Destroy();
+}
+
+void AAI_LevelController::PrewarmPool(const TSubclassOf<APawn> Class, const int32 Count, const FTransform& Transform)
+{
+	if (!Class || !Class->IsChildOf(AAI_PawnBase::StaticClass()))
+		return;
+
+	FAI_PawnPoolBucket& Bucket = PawnPool.FindOrAdd(Class);
+	const int32 TargetNum = FMath::Min(Bucket.Pawns.Num() + Count, MaxPooledPerClass);
+
+	// Pooled AI are hidden without collision, so they can all wait at the same place
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	while (Bucket.Pawns.Num() < TargetNum)
 	{
-		LevelControllerThread->RemoveAIFromPool(AICharacter);
+		AAI_PawnBase* Pawn = GetWorld()->SpawnActor<AAI_PawnBase>(Class, Transform, SpawnParameters);
+		if (!IsValid(Pawn))
+			break;
+
+		Pawn->PoolOwner = this;
+		Pawn->ResetForPool();
+		Bucket.Pawns.Add(Pawn);
+		INC_DWORD_STAT(STAT_AI_PooledPawns);
 	}
 }
 
-void AAI_LevelController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+AAI_PawnBase* AAI_LevelController::SpawnFromPool(const TSubclassOf<APawn> Class, const FTransform& Transform, const bool bDeferred)
 {
-	if(CurrentThread && LevelControllerThread)
+	if (!Class || !Class->IsChildOf(AAI_PawnBase::StaticClass()))
+		return nullptr;
+
+	if (FAI_PawnPoolBucket* Bucket = PawnPool.Find(Class))
 	{
-		CurrentThread->Suspend(true);
-		LevelControllerThread->bStopThread = true;
-		CurrentThread->Suspend(false);
-		CurrentThread->Kill(false);
-		CurrentThread->WaitForCompletion();
-		delete LevelControllerThread;
+		while (Bucket->Pawns.Num() > 0)
+		{
+			AAI_PawnBase* Pawn = Bucket->Pawns.Pop(false);
+			DEC_DWORD_STAT(STAT_AI_PooledPawns);
+
+			if (!IsValid(Pawn))
+				continue;
+
+			Pawn->ActivateFromPool(Transform);
+
+			PoolHits++;
+			INC_DWORD_STAT(STAT_AI_PawnPoolHits);
+			return Pawn;
+		}
 	}
 
-	Super::EndPlay(EndPlayReason);
+	PoolMisses++;
+	INC_DWORD_STAT(STAT_AI_PawnPoolMisses);
+
+	AAI_PawnBase* Pawn = bDeferred
+		? GetWorld()->SpawnActorDeferred<AAI_PawnBase>(Class, Transform, nullptr, nullptr,
+			ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn)
+		: GetWorld()->SpawnActor<AAI_PawnBase>(Class, Transform);
+	if (IsValid(Pawn))
+		Pawn->PoolOwner = this;
+
+	return Pawn;
 }
 
-// Called every frame
-void AAI_LevelController::Tick(float DeltaTime)
+void AAI_LevelController::QueueFinishSpawning(AAI_PawnBase* Pawn, const FTransform& Transform)
 {
-	Super::Tick(DeltaTime);
+	SpawnScheduler.QueueFinishSpawning(Pawn, Transform, GetWorld()->GetTimeSeconds());
+}
+
+void AAI_LevelController::GetSpawnTier(const FVector& Location, TEnumAsByte<EControllerStatus::EType>& OutStatus,
+	bool& bOutRendering) const
+{
+	float ClosestSquared = MAX_flt;
+	for (const FAI_Viewpoint& Viewpoint : Viewpoints)
+		ClosestSquared = FMath::Min(ClosestSquared, FVector::DistSquared(Viewpoint.Location, Location));
+
+	const FAI_LODSettings Settings = GetCurrentLODSettings();
+	OutStatus = ClosestSquared < FMath::Square(Settings.ThinkingBand.EnterDistance)
+		? EControllerStatus::Basic
+		: EControllerStatus::Sleep;
+	bOutRendering = ClosestSquared < FMath::Square(Settings.RenderingBand.EnterDistance);
+}
+
+bool AAI_LevelController::ReleaseToPool(AAI_PawnBase* Pawn)
+{
+	if (!IsValid(Pawn) || Pawn->PoolOwner.Get() != this)
+		return false;
+
+	if (Pawn->IsInPool())
+		return true;
+
+	FAI_PawnPoolBucket& Bucket = PawnPool.FindOrAdd(Pawn->GetClass());
+	if (Bucket.Pawns.Num() >= MaxPooledPerClass)
+		return false;
+
+	UnregisterPawn(Pawn);
+	Pawn->ResetForPool();
+	Bucket.Pawns.Add(Pawn);
+	INC_DWORD_STAT(STAT_AI_PooledPawns);
+	return true;
+}
+
+int32 AAI_LevelController::QueryAIInRadius(const FVector& Location, const float Radius, TArray<AAI_PawnBase*>& OutPawns,
+	const AAI_PawnBase* Ignore) const
+{
+	return SpatialGrid.QueryRadius(PawnRegistry, Location, Radius, OutPawns, Ignore);
+}
+
+void AAI_LevelController::PushAlert(const EAI_AlertType::EType Type, const FVector& Location, const AAI_PawnBase* Source,
+	const AAI_PawnBase* Target, const float RadiusOverride)
+{
+	FAI_Alert Alert;
+	Alert.Type = Type;
+	Alert.Location = Location;
+	Alert.RadiusOverride = RadiusOverride;
+	if (Source)
+		Alert.Source = Source->GetPawnHandle();
+	if (Target)
+		Alert.Target = Target->GetPawnHandle();
+
+	AlertBus.Push(Alert);
+}
+
+void AAI_LevelController::ReportGunshot(const FVector Location)
+{
+	PushAlert(EAI_AlertType::Gunshot, Location);
+}
+
+void AAI_LevelController::QueueSound(const FAI_SoundRequest& Request)
+{
+	AudioScheduler.Queue(Request);
+}
+
+void AAI_LevelController::QueueShot(AAI_PawnBase* Shooter, const AActor* Weapon, const FVector& Start, const FVector& End)
+{
+	FAI_ShotRequest Request;
+	Request.Shooter = IsValid(Shooter) ? Shooter->GetPawnHandle() : FAI_PawnHandle();
+	Request.Weapon = Weapon;
+	Request.Start = Start;
+	Request.End = End;
+	WeaponFire.Queue(Request);
+}
+
+bool AAI_LevelController::CanAddRagdoll() const
+{
+	return CorpseManager.NumRagdolls() < Corpses.MaxRagdolls;
+}
+
+bool AAI_LevelController::AddCorpse(AAI_PawnBase* Pawn, const float AnimationLength)
+{
+	return CorpseManager.Add(Pawn, GetWorld()->GetTimeSeconds(), AnimationLength, Corpses);
+}
+
+void AAI_LevelController::SetTimeSinceDestroy(const FAI_PawnHandle Handle, const float Time)
+{
+	if (PawnRegistry.IsCurrent(Handle))
+		ScoreManager.SetTimeSinceDestroy(Handle.Index, Time);
+}
+
+float AAI_LevelController::GetTimeSinceDestroy(const FAI_PawnHandle Handle) const
+{
+	return PawnRegistry.IsCurrent(Handle) ? ScoreManager.GetTimeSinceDestroy(Handle.Index) : -1.f;
+}
+
+void AAI_LevelController::SetImportanceFunction(FAI_ImportanceFunction NewFunction)
+{
+	// Snapshots still being read keep their own reference to the old function
+	ImportanceFunction = MakeShared<const FAI_ImportanceFunction, ESPMode::ThreadSafe>(MoveTemp(NewFunction));
+}
+
+bool AAI_LevelController::RegisterPawn(AAI_PawnBase* Pawn)
+{
+	if (PawnRegistry.Resolve(Pawn->GetPawnHandle()) == Pawn)
+		return false;
+
+	const FAI_PawnHandle Handle = PawnRegistry.Add(Pawn);
+	ScoreManager.Add(Handle.Index, Pawn);
+	Pawn->RegisteredLevelController = this;
+	ApplyAnimationLOD(Pawn, Pawn->GetControllerStatus());
+	return true;
+}
+
+bool AAI_LevelController::UnregisterPawn(AAI_PawnBase* Pawn)
+{
+	if (!IsValid(Pawn) || PawnRegistry.Resolve(Pawn->GetPawnHandle()) != Pawn)
+		return false;
+
+	Pawn->RegisteredLevelController.Reset();
+	return FreeSlot(Pawn->GetPawnHandle());
+}
+
+bool AAI_LevelController::FreeSlot(const FAI_PawnHandle Handle)
+{
+	if (!PawnRegistry.Remove(Handle))
+		return false;
+
+	ScoreManager.Remove(Handle.Index);
+
+	if (DestroyQueuedSlots.IsValidIndex(Handle.Index))
+		DestroyQueuedSlots[Handle.Index] = false;
+
+	return true;
+}
+
+void AAI_LevelController::PublishSnapshot()
+{
+	SCOPE_CYCLE_COUNTER(STAT_AI_LevelControllerPublish);
+
+	FAI_LevelSnapshot* Snapshot = SnapshotBuffer.BeginWrite();
+
+	// The LOD pass is still on the older snapshot, try again next frame
+	if (Snapshot == nullptr)
+		return;
+
+	Snapshot->WorldTime = GetWorld()->GetTimeSeconds();
+	Snapshot->Settings = GetCurrentLODSettings();
+	Snapshot->ImportanceFunction = ImportanceFunction;
+	Snapshot->Viewpoints = Viewpoints;
+
+	const int32 NumSlots = PawnRegistry.Num();
+	Snapshot->SetNumSlots(NumSlots);
+	DestroyQueuedSlots.SetNum(NumSlots, false);
 
-	Mutex.Lock();
+	for (int32 Slot = 0; Slot < NumSlots; Slot++)
 	{
-		uint8 Counter = ThinkEnablePerTick * FMath::RandBool();
-		while(Counter-- > 0 && !EnableThinkQueue.IsEmpty())
+		FAI_PawnHandle Handle = PawnRegistry.GetHandle(Slot);
+		AAI_PawnBase* Character = PawnRegistry.Resolve(Handle);
+
+		// Destroyed AI leave the registry
+		if (Handle.IsSet() && Character == nullptr)
 		{
-			if(AAI_PawnBase* Character; EnableThinkQueue.Dequeue(Character))
-			{
-				if (TEnumAsByte<EControllerStatus::EType> Status; EnableThinkMap.RemoveAndCopyValue(Character, Status))
-				{
-					Character->ChangeThinkingStatus(true, Status);
+			FreeSlot(Handle);
+			Handle.Reset();
+		}
 
-					GEngine->AddOnScreenDebugMessage(-1, 1, FColor::Cyan, "AI: " + Character->GetActorNameOrLabel() + " enabled Thinking");
-				}
+		// Dead AI are no longer ranked, they leave the registry once their destroy timer is started
+		if (Character != nullptr && Character->bIsDead)
+		{
+			if (!DestroyQueuedSlots[Slot])
+			{
+				DestroyQueue.Enqueue(Handle);
+				DestroyQueuedSlots[Slot] = true;
 			}
+			Character = nullptr;
 		}
 
-		Counter = ThinkDisablePerTick;
-		while (!DisableThinkQueue.IsEmpty() && Counter --> 0)
+		Snapshot->Handles[Slot] = Handle;
+		Snapshot->AliveFlags[Slot] = Character != nullptr;
+
+		if (Character != nullptr)
 		{
-			if (AAI_PawnBase* Character; DisableThinkQueue.Dequeue(Character))
-			{
-				DisableThinkSet.Remove(Character);
-				Character->ChangeThinkingStatus(false);
+			Snapshot->Positions[Slot] = Character->GetActorLocation();
+			Snapshot->Statuses[Slot] = Character->GetControllerStatus();
+			Snapshot->RenderingFlags[Slot] = Character->IsRendering();
+			Snapshot->RecentlyRenderedFlags[Slot] = Character->WasRecentlyRendered(0.2f);
 
-				GEngine->AddOnScreenDebugMessage(-1, 1, FColor::Magenta, "AI: " + Character->GetActorNameOrLabel() + " disabled Thinking");
+			const AAI_ControllerBase* AIController = Character->GetAIController();
+			Snapshot->KnownHostileFlags[Slot] = IsValid(AIController) && AIController->IsThereKnownHostilesVisible();
+
+			Snapshot->ImportanceStates[Slot] = EAI_ImportanceState::Other;
+			// A pooled AI's last state only changes once its State Manager ticks again
+			if (const UAI_StateManager* StateManager = Character->GetStateManager(); IsValid(StateManager) && !Character->IsReturningToPatrol())
+			{
+				if (StateManager->GetCurrentState() == AI_State::Destroy)
+					Snapshot->ImportanceStates[Slot] = EAI_ImportanceState::Destroy;
+				else if (StateManager->GetCurrentState() == AI_State::Search)
+					Snapshot->ImportanceStates[Slot] = EAI_ImportanceState::Search;
 			}
 		}
+		else
+		{
+			Snapshot->Positions[Slot] = FVector::ZeroVector;
+			Snapshot->Statuses[Slot] = EControllerStatus::None;
+			Snapshot->RenderingFlags[Slot] = false;
+			Snapshot->RecentlyRenderedFlags[Slot] = false;
+			Snapshot->KnownHostileFlags[Slot] = false;
+			Snapshot->ImportanceStates[Slot] = EAI_ImportanceState::Other;
+		}
+	}
+
+	SnapshotBuffer.EndWrite();
+}
 
-		Counter = RenderEnablePerTick * FMath::RandBool();
-		while (Counter-- > 0 && !EnableRenderQueue.IsEmpty())
+void AAI_LevelController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The LOD pass reads the snapshot and pushes to the ring, both are about to go away
+	WaitForLODPass();
+
+	AudioScheduler.StopAll();
+	CorpseManager.Reset();
+	WeaponFire.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AAI_LevelController::DrainCommands()
+{
+	FAI_LODCommand Command;
+	while (CommandRing.Pop(Command))
+	{
+		// The LOD pass changed its mind before the older command was finished
+		int32& WorkIndex = FindPendingWorkIndex(Command);
+		FAI_LODWork* Existing = WorkIndex != INDEX_NONE && PendingWork[WorkIndex].Command.Handle == Command.Handle
+			? &PendingWork[WorkIndex]
+			: nullptr;
+
+		if (Existing && Existing->Command.Status == Command.Status && Existing->Command.bRender == Command.bRender)
 		{
-			if (AAI_PawnBase* Character; EnableRenderQueue.Dequeue(Character))
-			{
-				EnableRenderSet.Remove(Character);
-				Character->ChangeRenderingStatus(true);
+			// Same transition sent again, keep the stages already applied
+			Existing->Command.Priority = Command.Priority;
+		}
+		else if (Existing)
+		{
+			*Existing = FAI_LODWork();
+			Existing->Command = Command;
+		}
+		else
+		{
+			// Added at the end, so the indices of the others stay valid until the next sort
+			WorkIndex = PendingWork.Num();
+			PendingWork.AddDefaulted_GetRef().Command = Command;
+		}
+		bPendingWorkDirty = true;
+	}
+}
+
+int32& AAI_LevelController::FindPendingWorkIndex(const FAI_LODCommand& Command)
+{
+	TArray<int32>& Indices = Command.Type == EAI_LODCommand::Rendering ? PendingRenderingWork : PendingThinkingWork;
+	if (!Indices.IsValidIndex(Command.Handle.Index))
+	{
+		const int32 OldNum = Indices.Num();
+		Indices.SetNumUninitialized(Command.Handle.Index + 1, false);
+		for (int32 Slot = OldNum; Slot < Indices.Num(); Slot++)
+			Indices[Slot] = INDEX_NONE;
+	}
+	return Indices[Command.Handle.Index];
+}
+
+void AAI_LevelController::RebuildPendingWorkIndex()
+{
+	for (int32& Index : PendingThinkingWork)
+		Index = INDEX_NONE;
+	for (int32& Index : PendingRenderingWork)
+		Index = INDEX_NONE;
+
+	for (int32 Index = 0; Index < PendingWork.Num(); Index++)
+		FindPendingWorkIndex(PendingWork[Index].Command) = Index;
+}
+
+void AAI_LevelController::ApplyPendingWork()
+{
+	SCOPE_CYCLE_COUNTER(STAT_AI_LevelControllerApply);
+
+	bool bReordered = false;
+	if (bPendingWorkDirty)
+	{
+		Algo::SortBy(PendingWork, [](const FAI_LODWork& Work) { return Work.Command.Priority; });
+		bPendingWorkDirty = false;
+		bReordered = true;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = TransitionBudgetMicroseconds * 0.000001;
+	bool bAppliedAny = false;
+
+	auto HasBudget = [&]()
+		{
+			// Always make progress, even if one transition is bigger than the whole budget
+			return !bAppliedAny || FPlatformTime::Seconds() - StartTime < Budget;
+		};
+
+	bool bAnyDone = false;
+	for (FAI_LODWork& Work : PendingWork)
+	{
+		if (!HasBudget())
+			break;
+
+		// Wakes apply one stage per call, so one stage per AI per frame
+		Work.bDone = ApplyWork(Work);
+		bAnyDone |= Work.bDone;
+		bAppliedAny = true;
+	}
 
+	if (bAnyDone)
+	{
+		PendingWork.RemoveAll([](const FAI_LODWork& Work) { return Work.bDone; });
+		bReordered = true;
+	}
+
+	if (bReordered)
+		RebuildPendingWorkIndex();
+
+	// Destroy requests are the least important and share what is left
+	while (!DestroyQueue.IsEmpty() && HasBudget())
+	{
+		FAI_PawnHandle Handle;
+		DestroyQueue.Dequeue(Handle);
+
+		// Tracked corpses are removed by the corpse manager
+		if (AAI_PawnBase* Pawn = PawnRegistry.Resolve(Handle); IsValid(Pawn) && !CorpseManager.Contains(Pawn))
+			Pawn->StartDestroyTimer();
+
+		FreeSlot(Handle);
+
+		bAppliedAny = true;
+	}
+}
+
+bool AAI_LevelController::ApplyWork(FAI_LODWork& Work)
+{
+	const FAI_LODCommand& Command = Work.Command;
+
+	// Stale handles resolve to nothing, the AI was removed or its slot reused
+	AAI_PawnBase* Character = PawnRegistry.Resolve(Command.Handle);
+	if (!IsValid(Character) || Character->bIsDead)
+		return true;
+
+	if (Command.Type == EAI_LODCommand::Rendering)
+	{
+		Character->ChangeRenderingStatus(Command.bRender);
+		ApplyAnimationLOD(Character, Character->GetControllerStatus());
+		TransitionsThisWindow++;
+
+		if (bPrintLODTransitions)
+		{
+			if (Command.bRender)
 				GEngine->AddOnScreenDebugMessage(-1, 1, FColor::Cyan, "AI: " + Character->GetActorNameOrLabel() + " enabled Rendering");
-			}
+			else
+				GEngine->AddOnScreenDebugMessage(-1, 1, FColor::Magenta, "AI: " + Character->GetActorNameOrLabel() + " disabled Rendering");
+		}
+
+		return true;
+	}
+
+	if (Command.Status == EControllerStatus::Sleep)
+	{
+		Character->ChangeThinkingStatus(false);
+		ApplyAnimationLOD(Character, EControllerStatus::Sleep);
+		TransitionsThisWindow++;
+
+		if (bPrintLODTransitions)
+			GEngine->AddOnScreenDebugMessage(-1, 1, FColor::Magenta, "AI: " + Character->GetActorNameOrLabel() + " disabled Thinking");
+		return true;
+	}
+
+	// Perception, then Behavior Tree, then Movement on following frames
+	Character->ApplyWakeStage(static_cast<EWakeStage::EType>(Work.NextStage), Command.Status);
+
+	if (++Work.NextStage < EWakeStage::Num)
+		return false;
+
+	ApplyAnimationLOD(Character, Command.Status);
+	TransitionsThisWindow++;
+
+	if (bPrintLODTransitions)
+		GEngine->AddOnScreenDebugMessage(-1, 1, FColor::Cyan, "AI: " + Character->GetActorNameOrLabel() + " enabled Thinking");
+	return true;
+}
+
+void AAI_LevelController::UpdateTransitionRate(const float DeltaTime)
+{
+	TransitionWindowTime += DeltaTime;
+	if (TransitionWindowTime < TransitionRateWindow)
+		return;
+
+	LODTransitionsPerSecond = TransitionsThisWindow / TransitionWindowTime;
+	SET_FLOAT_STAT(STAT_AI_LODTransitionsPerSecond, LODTransitionsPerSecond);
+
+	TransitionsThisWindow = 0;
+	TransitionWindowTime = 0.f;
+}
+
+void AAI_LevelController::GatherViewpoints(TArray<FAI_Viewpoint>& OutViewpoints)
+{
+	OutViewpoints.Reset();
+
+	// One per local player, split-screen views have their own aspect ratio in the camera cache
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (!IsValid(PlayerController) || !PlayerController->IsLocalController())
+			continue;
+
+		FAI_Viewpoint& Viewpoint = OutViewpoints.AddDefaulted_GetRef();
+		if (const APlayerCameraManager* CameraManager = PlayerController->PlayerCameraManager)
+		{
+			const FMinimalViewInfo& View = CameraManager->GetCameraCacheView();
+			Viewpoint.Set(View.Location, View.Rotation, View.FOV, View.AspectRatio);
+		}
+		else
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			Viewpoint.Set(ViewLocation, ViewRotation, 90.f, 16.f / 9.f);
+		}
+	}
+
+	// Spectator and streaming cameras
+	for (int32 Index = ViewpointCameras.Num() - 1; Index >= 0; Index--)
+	{
+		const UCameraComponent* Camera = ViewpointCameras[Index].Get();
+		if (!IsValid(Camera))
+		{
+			ViewpointCameras.RemoveAtSwap(Index);
+			continue;
 		}
 
-		Counter = RenderDisablePerTick;
-		while (!DisableRenderQueue.IsEmpty() && Counter --> 0)
+		if (!Camera->IsActive())
+			continue;
+
+		OutViewpoints.AddDefaulted_GetRef().Set(Camera->GetComponentLocation(), Camera->GetComponentRotation(),
+			Camera->FieldOfView, Camera->AspectRatio);
+	}
+}
+
+void AAI_LevelController::AddViewpointCamera(UCameraComponent* Camera)
+{
+	if (IsValid(Camera))
+		ViewpointCameras.AddUnique(Camera);
+}
+
+void AAI_LevelController::RemoveViewpointCamera(UCameraComponent* Camera)
+{
+	ViewpointCameras.RemoveSingleSwap(Camera);
+}
+
+FAI_LODSettings AAI_LevelController::GetCurrentLODSettings() const
+{
+	FAI_LODSettings Settings;
+	Settings.ImportanceWeights = ImportanceWeights;
+	Settings.bPauseAnimationOutOfView = bPauseAnimationOutOfView;
+	Settings.OutOfViewAnimationDistance = OutOfViewAnimationDistance;
+	Settings.FrustumPadding = FrustumPadding;
+	Settings.IntelligentBand = IntelligentBand;
+	Settings.ThinkingBand = ThinkingBand;
+	Settings.RenderingBand = RenderingBand;
+
+	if (!PopulationBudget.bEnabled)
+	{
+		Settings.NumOfThinkingCharacters = NumberOfThinkingCharacters;
+		Settings.NumOfIntelligentCharacters = NumberOfIntelligentCharacters;
+		return Settings;
+	}
+
+	Settings.NumOfThinkingCharacters = CurrentThinkingCharacters;
+	Settings.NumOfIntelligentCharacters = FMath::Min(CurrentIntelligentCharacters, CurrentThinkingCharacters);
+
+	for (FAI_LODBand* Band : { &Settings.IntelligentBand, &Settings.ThinkingBand, &Settings.RenderingBand })
+	{
+		Band->EnterDistance *= CurrentDistanceScale;
+		Band->ExitDistance *= CurrentDistanceScale;
+	}
+	return Settings;
+}
+
+void AAI_LevelController::ApplyAnimationLOD(AAI_PawnBase* Pawn, const TEnumAsByte<EControllerStatus::EType> Status) const
+{
+	const FAI_AnimationTier& Tier = Status == EControllerStatus::Normal ? NormalAnimation
+		: Status == EControllerStatus::Basic ? BasicAnimation
+		: SleepAnimation;
+
+	// The most important AI always animate at their tier's rate
+	const int32 ExtraFrameSkip = Status == EControllerStatus::Normal ? 0 : CurrentAnimationExtraFrameSkip;
+
+	Pawn->SetAnimationLOD(FMath::Min(Tier.FrameSkip + ExtraFrameSkip, 15), Tier.MinLOD, Tier.bInterpolateSkippedFrames,
+		Tier.bOnlyTickPoseWhenRendered);
+}
+
+void AAI_LevelController::UpdateAnimationBudget(const float DeltaTime)
+{
+	TimeSinceAnimationBudget += DeltaTime;
+	if (TimeSinceAnimationBudget < AnimationBudget.AdjustInterval)
+		return;
+
+	TimeSinceAnimationBudget = 0.f;
+
+	// Rendered AI per tier, paused animations cost nothing
+	int32 NumNormal = 0;
+	int32 NumBasic = 0;
+	int32 NumSleep = 0;
+	for (int32 Slot = 0; Slot < PawnRegistry.Num(); Slot++)
+	{
+		const AAI_PawnBase* Pawn = PawnRegistry.GetPawn(Slot);
+		if (!Pawn || Pawn->bIsDead || !Pawn->IsRendering())
+			continue;
+
+		switch (Pawn->GetControllerStatus())
+		{
+		case EControllerStatus::Normal:
+			NumNormal++;
+			break;
+		case EControllerStatus::Basic:
+			NumBasic++;
+			break;
+		default:
+			NumSleep++;
+			break;
+		}
+	}
+
+	auto Load = [&](const int32 ExtraFrameSkip)
+		{
+			return NumNormal / (NormalAnimation.FrameSkip + 1.f)
+				+ NumBasic / (BasicAnimation.FrameSkip + ExtraFrameSkip + 1.f)
+				+ NumSleep / (SleepAnimation.FrameSkip + ExtraFrameSkip + 1.f);
+		};
+
+	// Smallest extra skip that fits, the budget can only slow Basic and Sleep down
+	int32 ExtraFrameSkip = 0;
+	if (AnimationBudget.bEnabled)
+	{
+		while (ExtraFrameSkip < AnimationBudget.MaxExtraFrameSkip && Load(ExtraFrameSkip) > AnimationBudget.MaxFullRateUpdates)
+			ExtraFrameSkip++;
+	}
+
+	SET_FLOAT_STAT(STAT_AI_AnimationBudgetLoad, Load(ExtraFrameSkip));
+	SET_DWORD_STAT(STAT_AI_AnimationExtraFrameSkip, ExtraFrameSkip);
+
+	if (ExtraFrameSkip == CurrentAnimationExtraFrameSkip)
+		return;
+
+	CurrentAnimationExtraFrameSkip = ExtraFrameSkip;
+
+	// Only AI outside Normal change, SetAnimationLOD skips those already at their rate
+	for (int32 Slot = 0; Slot < PawnRegistry.Num(); Slot++)
+	{
+		if (AAI_PawnBase* Pawn = PawnRegistry.GetPawn(Slot); Pawn && !Pawn->bIsDead
+			&& Pawn->GetControllerStatus() != EControllerStatus::Normal)
+			ApplyAnimationLOD(Pawn, Pawn->GetControllerStatus());
+	}
+}
+
+void AAI_LevelController::UpdateRenderCost(const float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AI_RenderCost);
+
+	TimeSinceRenderCost += DeltaTime;
+	if (TimeSinceRenderCost >= RenderCost.UpdateInterval)
+	{
+		TimeSinceRenderCost = 0.f;
+
+		for (int32 Slot = 0; Slot < PawnRegistry.Num(); Slot++)
 		{
-			if (AAI_PawnBase* Character; DisableRenderQueue.Dequeue(Character))
+			const AAI_PawnBase* Pawn = PawnRegistry.GetPawn(Slot);
+			if (!Pawn || Pawn->bIsDead)
+				continue;
+
+			const FVector Location = Pawn->GetActorLocation();
+
+			float ClosestSquared = MAX_flt;
+			bool bInView = false;
+			for (const FAI_Viewpoint& Viewpoint : Viewpoints)
 			{
-				DisableRenderSet.Remove(Character);
-				Character->ChangeRenderingStatus(false);
+				ClosestSquared = FMath::Min(ClosestSquared, FVector::DistSquared(Viewpoint.Location, Location));
+				bInView |= Viewpoint.IsInFrustum(Location, FrustumPadding);
+			}
 
-				GEngine->AddOnScreenDebugMessage(-1, 1, FColor::Magenta, "AI: " + Character->GetActorNameOrLabel() + " disabled Rendering");
+			FAI_PendingRenderCost Cost;
+			if (RenderCost.bEnabled)
+			{
+				Cost.bCastShadows = bInView && ClosestSquared < FMath::Square(RenderCost.ShadowDistance);
+				Cost.ForcedLOD = bInView && ClosestSquared < FMath::Square(RenderCost.FullDetailDistance) ? 0 : RenderCost.ReducedLOD + 1;
+				Cost.bShowWeapons = bInView && ClosestSquared < FMath::Square(RenderCost.WeaponDistance);
 			}
+
+			const FAI_PawnHandle Handle = PawnRegistry.GetHandle(Slot);
+			if (Pawn->HasRenderCost(Cost.bCastShadows, Cost.ForcedLOD, Cost.bShowWeapons))
+				PendingRenderCost.Remove(Handle);
+			else
+				PendingRenderCost.Add(Handle, Cost);
 		}
+	}
 
-		if (AAI_PawnBase* Pawn; !DestroyQueue.IsEmpty() && DestroyQueue.Dequeue(Pawn))
-			Pawn->StartDestroyTimer();
+	// Applied together, so the render proxies of a frame's changes are recreated in one go
+	int32 NumApplied = 0;
+	for (auto It = PendingRenderCost.CreateIterator(); It && NumApplied < RenderCost.MaxChangesPerTick; ++It)
+	{
+		if (AAI_PawnBase* Pawn = PawnRegistry.Resolve(It.Key()); Pawn && !Pawn->bIsDead)
+		{
+			const FAI_PendingRenderCost& Cost = It.Value();
+			Pawn->SetRenderCost(Cost.bCastShadows, Cost.ForcedLOD, Cost.bShowWeapons);
+			NumApplied++;
+		}
+		It.RemoveCurrent();
+	}
+
+	INC_DWORD_STAT_BY(STAT_AI_RenderCostChanges, NumApplied);
+	SET_DWORD_STAT(STAT_AI_RenderCostWaiting, PendingRenderCost.Num());
+}
+
+void AAI_LevelController::UpdatePopulationBudget(const float DeltaTime, const float LevelControllerMs)
+{
+	if (!PopulationBudget.bEnabled)
+		return;
+
+	const float GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	const float AIMs = LevelControllerMs + FPlatformTime::ToMilliseconds(LODPassCycles.load(std::memory_order_relaxed));
+
+	PopulationBudgetController.Update(PopulationBudget, DeltaTime, GameThreadMs, AIMs);
+
+	CurrentThinkingCharacters = PopulationBudgetController.GetThinkingCharacters(PopulationBudget);
+	CurrentIntelligentCharacters = PopulationBudgetController.GetIntelligentCharacters(PopulationBudget);
+	CurrentDistanceScale = PopulationBudgetController.GetDistanceScale(PopulationBudget);
+
+	SET_FLOAT_STAT(STAT_AI_PopulationBudgetLevel, PopulationBudgetController.GetLevel());
+	SET_DWORD_STAT(STAT_AI_BudgetThinkingCharacters, CurrentThinkingCharacters);
+	SET_DWORD_STAT(STAT_AI_BudgetIntelligentCharacters, CurrentIntelligentCharacters);
+}
+
+// Called every frame
+void AAI_LevelController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Last frame's LOD pass, it has had the whole frame so this rarely waits
+	WaitForLODPass();
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+
+	DrainCommands();
+	ApplyPendingWork();
+
+	// Before this frame's spawns and despawns, new AI get their scores written next frame
+	ScoreManager.Update(PawnRegistry, DeltaTime);
+
+	GatherViewpoints(Viewpoints);
+	UpdateSpawnerActivation(DeltaTime);
+	SpawnScheduler.Process(*this, Viewpoints, GetWorld()->GetTimeSeconds(), SpawnBudgetMicroseconds * 0.000001,
+		MaxFinishSpawningPerTick, FrustumPadding, MaxDespawnDelay);
+
+	// Uses last frame's Level Controller time, this frame's is not finished yet
+	UpdatePopulationBudget(DeltaTime, LastLevelControllerMs);
+	UpdateAnimationBudget(DeltaTime);
+	UpdateRenderCost(DeltaTime);
+
+#if STATS
+	{
+		int32 NumBodies = 0;
+		int32 NumSleeping = 0;
+		for (int32 Slot = 0; Slot < PawnRegistry.Num(); Slot++)
+		{
+			if (const AAI_PawnBase* Pawn = PawnRegistry.GetPawn(Slot))
+			{
+				NumBodies += Pawn->GetNumActivePhysicsBodies();
+				NumSleeping += Pawn->IsPhysicsSleeping() ? 1 : 0;
+			}
+		}
+		SET_DWORD_STAT(STAT_AI_PhysicsBodies, NumBodies);
+		SET_DWORD_STAT(STAT_AI_PhysicsSleeping, NumSleeping);
 	}
-	Mutex.Unlock();
+#endif
+
+	INC_DWORD_STAT_BY(STAT_AI_LODCommandsOverflowed, CommandOverflowCount.exchange(0, std::memory_order_relaxed));
+	INC_DWORD_STAT_BY(STAT_AI_LODCommandsCoalesced, CommandCoalescedCount.exchange(0, std::memory_order_relaxed));
+	SET_DWORD_STAT(STAT_AI_LODCommandsWaiting, PendingWork.Num());
+	UpdateTransitionRate(DeltaTime);
+
+	// Last frame's shots land before the grid, so AI they kill are left out of it
+	WeaponFire.Process(*this, ShotTraceChannel);
+
+	// After this frame's spawns and despawns, queries until the next tick see them
+	SpatialGrid.Rebuild(PawnRegistry, SpatialGridCellSize);
+
+	const FAI_AlertSettings AlertSettings[EAI_AlertType::Num] = { GunshotAlert, DamageAlert, SightingAlert };
+	AlertBus.Deliver(*this, AlertSettings, AlertMergeDistance);
+
+	const FAI_SoundCategorySettings AudioSettings[EAI_SoundCategory::Num] = { DeathAudio, DamageAudio, CombatAudio };
+	AudioScheduler.Process(*this, Viewpoints, AudioSettings, MaxAIVoices);
+	CorpseManager.Update(GetWorld()->GetTimeSeconds(), Corpses);
+
+	// Hand this frame's positions and statuses to the LOD pass
+	PublishSnapshot();
+	LaunchLODPass(DeltaTime);
+
+	LastLevelControllerMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
 }
 
+void AAI_LevelController::LaunchLODPass(const float DeltaTime)
+{
+	TimeSinceLODPass += DeltaTime;
+	if (LODPassRate > 0.f && TimeSinceLODPass < 1.f / LODPassRate)
+		return;
+
+	TimeSinceLODPass = 0.f;
+
+	LODTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this]()
+		{
+			LODEvaluator.Run();
+		});
+}
+
+void AAI_LevelController::WaitForLODPass()
+{
+	if (LODTask.IsValid())
+		LODTask.Wait();
+}
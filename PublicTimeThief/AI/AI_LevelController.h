@@ -0,0 +1,491 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "GameFramework/Actor.h"
+#include "Tasks/Task.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+#include "AI_AlertBus.h"
+#include "AI_AudioScheduler.h"
+#include "AI_CorpseManager.h"
+#include "AI_LODSettings.h"
+#include "AI_LevelSnapshot.h"
+#include "AI_LODCommandRing.h"
+#include "AI_PopulationBudget.h"
+#include "AI_PawnRegistry.h"
+#include "AI_PawnPool.h"
+#include "AI_ScoreManager.h"
+#include "AI_SpatialGrid.h"
+#include "AI_SpawnScheduler.h"
+#include "AI_WeaponFire.h"
+#include "AI_LevelController.generated.h"
+
+class AAI_LevelController;
+class AAI_SpawnerBase;
+class UCameraComponent;
+
+DECLARE_STATS_GROUP(TEXT("TimeThief AI"), STATGROUP_TimeThiefAI, STATCAT_Advanced);
+
+// A drained LOD command waiting for the frame budget, wakes are applied one stage per frame
+struct FAI_LODWork
+{
+	FAI_LODCommand Command;
+	uint8 NextStage = 0;
+	bool bDone = false;
+};
+
+/**
+ * LOD pass that ranks every AI by importance to the viewpoints and decides
+ * which AI should be Intelligent, Thinking, Sleeping and Rendering
+ * Runs as a task launched by the Level Controller's Tick, only reads the published snapshot, never the AI themselves
+ */
+class FAI_LODEvaluator
+{
+public:
+	// Evaluates the latest published snapshot, does nothing if it was already evaluated
+	void Run();
+
+	AAI_LevelController* LevelController = nullptr;
+
+private:
+	// Runs the LOD pass over one snapshot
+	void Evaluate(const FAI_LevelSnapshot& Snapshot);
+
+	// Sizes the per-slot arrays to the snapshot, only allocates when the registry grows past its peak
+	void ResizeArrays(int32 NumSlots);
+	// Gathers squared distances and importance scores for every slot (parallel) and the ranks of the alive ones
+	int32 GatherScores(const FAI_LevelSnapshot& Snapshot);
+	// Partially orders RankOrder so every boundary splits the most important AI from the rest, Boundaries must be ascending
+	void SelectMostImportant(int32 NumRanked, TConstArrayView<int32> Boundaries);
+	// Applies the bands, rank slack and dwell times to the AI at Rank
+	void DecideTier(const FAI_LevelSnapshot& Snapshot, int32 Rank, int32 ThinkingCount, int32 IntelligentCount);
+
+	// Sends a command unless the same transition is already pending for that slot
+	void RequestThinkingStatus(const FAI_LevelSnapshot& Snapshot, int32 Slot, const TEnumAsByte<EControllerStatus::EType> Status);
+	void RequestRenderingStatus(const FAI_LevelSnapshot& Snapshot, int32 Slot, const bool bRender);
+	// Clears pending transitions that were applied, went stale or belong to a previous AI in the slot
+	// and tracks when the slot last changed tier
+	void UpdateSlotState(const FAI_LevelSnapshot& Snapshot, int32 Slot);
+
+	uint64 LastSnapshotVersion = 0;
+
+	// Pending transition bits per slot, only touched by this thread
+	enum EPendingBits : uint8
+	{
+		PendingStatusMask = 0x03,	// Requested EControllerStatus
+		PendingThinking = 0x04,
+		PendingRenderOn = 0x08,		// Requested rendering state
+		PendingRendering = 0x10
+	};
+	TArray<uint8> PendingState;
+	TArray<uint64> PendingVersion;
+	TArray<FAI_PawnHandle> PendingOwner;
+
+	// Last seen tier per slot and the world time it was entered, for the dwell times
+	TArray<TEnumAsByte<EControllerStatus::EType>> SeenStatus;
+	TArray<uint8> SeenRendering;
+	TArray<double> StatusSince;
+	TArray<double> RenderingSince;
+
+	// Per slot arrays for the LOD pass, indexed like the snapshot and reused every pass
+	TArray<float> DistancesSquared;
+	TArray<float> Scores;
+	TArray<uint8> InViewFlags;
+	TArray<int32> RankOrder;
+	TArray<TEnumAsByte<EControllerStatus::EType>> DesiredStatus;
+	TArray<uint8> DesiredRendering;
+
+	// Pending transitions older than this many snapshots are sent again
+	static constexpr uint64 PendingRetryVersions = 120;
+};
+
+UCLASS()
+class PROJECTTIMETHIEF_API AAI_LevelController : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	AAI_LevelController();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	void AddAIToThreadPool(AAI_PawnBase* AICharacter);
+	void RemoveAIFromThreadPool(AAI_PawnBase* AICharacter);
+
+	// Adds a camera that is not a player's (spectator, streaming, etc.) as a viewpoint for the LOD tiers
+	UFUNCTION(BlueprintCallable, Category = "AI Level Controller")
+	void AddViewpointCamera(UCameraComponent* Camera);
+
+	UFUNCTION(BlueprintCallable, Category = "AI Level Controller")
+	void RemoveViewpointCamera(UCameraComponent* Camera);
+
+	// Spawners whose flock is activated and deactivated by distance to the viewpoints
+	void RegisterSpawner(AAI_SpawnerBase* Spawner);
+	void UnregisterSpawner(AAI_SpawnerBase* Spawner);
+
+	// Spawns the sheep when the spawn scheduler gets to it, spawns closest to a viewpoint go first
+	void QueueSpawn(AAI_SpawnerBase* Spawner, const FVector& Location, const FRotator& Rotation);
+	// Unregisters the AI and returns it to the pool, or destroys it, without waiting for the scheduler
+	void DespawnNow(AAI_PawnBase* Pawn);
+	// The registered AI the handle names, nullptr if the handle is stale
+	FORCEINLINE AAI_PawnBase* ResolvePawn(const FAI_PawnHandle Handle) const { return PawnRegistry.Resolve(Handle); }
+
+	// Spawns up to Count hidden, sleeping AI of Class into the pool at Transform, call while the level loads
+	void PrewarmPool(TSubclassOf<APawn> Class, int32 Count, const FTransform& Transform);
+	// Hands out a pooled AI of Class at Transform, or spawns one if the pool is empty
+	// With bDeferred a spawned AI has not finished spawning, set it up and pass it to QueueFinishSpawning
+	// Returns nullptr if Class is not an AI
+	AAI_PawnBase* SpawnFromPool(TSubclassOf<APawn> Class, const FTransform& Transform, bool bDeferred = false);
+	// Finishes spawning a deferred AI on a later frame and registers it, at most MaxFinishSpawningPerTick a frame
+	void QueueFinishSpawning(AAI_PawnBase* Pawn, const FTransform& Transform);
+	// Tier an AI spawned at Location should start in, from its distance to the closest viewpoint
+	// Ranking is left to the LOD pass, so nothing starts above Basic
+	void GetSpawnTier(const FVector& Location, TEnumAsByte<EControllerStatus::EType>& OutStatus, bool& bOutRendering) const;
+	// Unregisters and resets the AI and keeps it for SpawnFromPool, returns false if it is not from this pool or the pool is full
+	bool ReleaseToPool(AAI_PawnBase* Pawn);
+
+	// Appends the living registered AI within Radius of Location to OutPawns, except Ignore, returns how many were added
+	// Positions are as of this Level Controller's last tick
+	int32 QueryAIInRadius(const FVector& Location, float Radius, TArray<AAI_PawnBase*>& OutPawns,
+		const AAI_PawnBase* Ignore = nullptr) const;
+
+	// Queues an alert, the AI that hear it respond during the next tick
+	// Source never responds to its own alert, Target always responds at full strength
+	void PushAlert(EAI_AlertType::EType Type, const FVector& Location, const AAI_PawnBase* Source = nullptr,
+		const AAI_PawnBase* Target = nullptr, float RadiusOverride = 0.f);
+
+	// For weapons that are not an AI's, e.g. the player's
+	UFUNCTION(BlueprintCallable, Category = "AI Level Controller")
+	void ReportGunshot(FVector Location);
+
+	// Queues an AI sound, played on the next tick if it is close enough and wins a voice
+	void QueueSound(const FAI_SoundRequest& Request);
+
+	// Queues a hitscan shot, traced with the others on the next tick and resolved on Shooter when the trace comes back
+	void QueueShot(AAI_PawnBase* Shooter, const AActor* Weapon, const FVector& Start, const FVector& End);
+
+	// True while another ragdoll fits in the budget
+	bool CanAddRagdoll() const;
+	// Tracks a dying AI until its corpse is removed, returns true if it should ragdoll
+	// AnimationLength is how long its death animation plays, 0 if it has none
+	bool AddCorpse(AAI_PawnBase* Pawn, float AnimationLength);
+
+	// Destroy timer of a registered AI, kept with its other blackboard scores
+	void SetTimeSinceDestroy(FAI_PawnHandle Handle, float Time);
+	float GetTimeSinceDestroy(FAI_PawnHandle Handle) const;
+
+	// Replaces how AI are scored for the LOD tiers, takes effect with the next snapshot
+	// The function runs on worker threads and may only use its arguments
+	void SetImportanceFunction(FAI_ImportanceFunction NewFunction);
+
+	// Written by Tick, read by the LOD pass
+	FAI_LevelSnapshotBuffer SnapshotBuffer;
+
+	// Written by the LOD pass, drained by Tick
+	FAI_LODCommandRing CommandRing;
+
+	// Commands that did not fit in the ring and will be sent again
+	std::atomic<uint32> CommandOverflowCount{ 0 };
+	// Commands skipped because the same transition was already pending
+	std::atomic<uint32> CommandCoalescedCount{ 0 };
+
+	// Cycles the last LOD pass took on its worker
+	std::atomic<uint32> LODPassCycles{ 0 };
+
+	// Dead AI waiting for their destroy timer, they stay registered until it is started
+	TQueue<FAI_PawnHandle> DestroyQueue;
+
+	// Thinking and Rendering changes applied per second, averaged over TransitionRateWindow
+	UPROPERTY(VisibleInstanceOnly, Category = "AI Level Controller|Stats")
+	float LODTransitionsPerSecond = 0.f;
+
+	// Prints every applied LOD transition on screen, the printing counts against the transition budget
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Stats")
+	bool bPrintLODTransitions = false;
+
+protected:
+	// Launches the LOD pass over the snapshot just published, at most LODPassRate times per second
+	void LaunchLODPass(float DeltaTime);
+	// Blocks until the last launched LOD pass has finished, it normally finished during the previous frame
+	void WaitForLODPass();
+
+	FAI_LODEvaluator LODEvaluator;
+	UE::Tasks::FTask LODTask;
+	float TimeSinceLODPass = 0.f;
+
+	// Moves every command out of the ring into PendingWork, a newer command replaces an older one for the same AI
+	void DrainCommands();
+	// Applies PendingWork in priority order until TransitionBudgetMicroseconds is used up
+	void ApplyPendingWork();
+	// Applies the next step of Work, returns true when the transition is complete
+	bool ApplyWork(FAI_LODWork& Work);
+
+	// Drained commands, sorted by priority whenever new ones arrive
+	TArray<FAI_LODWork> PendingWork;
+	bool bPendingWorkDirty = false;
+
+	// Index into PendingWork of each slot's thinking and rendering work, INDEX_NONE for none
+	// Rebuilt whenever PendingWork is sorted or shrunk, so draining a command never searches PendingWork
+	TArray<int32> PendingThinkingWork;
+	TArray<int32> PendingRenderingWork;
+	void RebuildPendingWorkIndex();
+	int32& FindPendingWorkIndex(const FAI_LODCommand& Command);
+
+	void UpdateTransitionRate(float DeltaTime);
+
+	uint32 TransitionsThisWindow = 0;
+	float TransitionWindowTime = 0.f;
+	static constexpr float TransitionRateWindow = 1.f;
+
+	// Copies the registered AI into the back snapshot and publishes it
+	void PublishSnapshot();
+
+	// Counts and bands for this frame, scaled by the population budget
+	FAI_LODSettings GetCurrentLODSettings() const;
+	// Fills OutViewpoints from every local player's camera and the registered cameras
+	void GatherViewpoints(TArray<FAI_Viewpoint>& OutViewpoints);
+
+	// This frame's viewpoints, copied into the snapshot
+	TArray<FAI_Viewpoint> Viewpoints;
+
+	FAI_SpawnScheduler SpawnScheduler;
+
+	// Deactivates far flocks and activates near ones, closest first, while the live cap allows
+	void UpdateSpawnerActivation(float DeltaTime);
+
+	TArray<TWeakObjectPtr<AAI_SpawnerBase>> Spawners;
+	float TimeSinceSpawnerActivation = 0.f;
+
+	TSharedPtr<const FAI_ImportanceFunction, ESPMode::ThreadSafe> ImportanceFunction;
+	// Feeds this frame's timings into the population budget
+	void UpdatePopulationBudget(float DeltaTime, float LevelControllerMs);
+
+	FAI_PopulationBudget PopulationBudgetController;
+	float LastLevelControllerMs = 0.f;
+
+	// Gives the AI the animation tier of Status, with the budget's extra skip outside Normal
+	void ApplyAnimationLOD(AAI_PawnBase* Pawn, TEnumAsByte<EControllerStatus::EType> Status) const;
+	// Raises or lowers the extra frame skip until the rendered AI fit in the animation budget
+	void UpdateAnimationBudget(float DeltaTime);
+
+	float TimeSinceAnimationBudget = 0.f;
+
+	// Render cost an AI should have, waiting to be applied
+	struct FAI_PendingRenderCost
+	{
+		int32 ForcedLOD = 0;
+		bool bCastShadows = true;
+		bool bShowWeapons = true;
+	};
+
+	// Checks every AI's render cost each RenderCost.UpdateInterval, and applies waiting changes
+	void UpdateRenderCost(float DeltaTime);
+
+	// Keyed by AI, so a newer change replaces one still waiting
+	TMap<FAI_PawnHandle, FAI_PendingRenderCost> PendingRenderCost;
+	float TimeSinceRenderCost = 0.f;
+
+	// Adds the AI to a free registry slot, returns false if it was already registered
+	bool RegisterPawn(AAI_PawnBase* Pawn);
+	// Frees the AI's registry slot, returns false if it was not registered
+	bool UnregisterPawn(AAI_PawnBase* Pawn);
+	// Frees the handle's slot, returns false if the handle was stale
+	bool FreeSlot(FAI_PawnHandle Handle);
+
+	TArray<TWeakObjectPtr<UCameraComponent>> ViewpointCameras;
+
+	// Pooled AI by class
+	UPROPERTY()
+	TMap<UClass*, FAI_PawnPoolBucket> PawnPool;
+
+	// Registered AI, the snapshot, LOD commands and queues only hold handles into it
+	FAI_PawnRegistry PawnRegistry;
+
+	// Blackboard scores of the registered AI, by registry slot
+	FAI_ScoreManager ScoreManager;
+
+	// Positions of the living registered AI for radius queries
+	FAI_SpatialGrid SpatialGrid;
+
+	// Alerts pushed this frame, delivered once the spatial grid is rebuilt
+	FAI_AlertBus AlertBus;
+
+	// Sounds of every AI, played on pooled audio components
+	FAI_AudioScheduler AudioScheduler;
+
+	// Dead AI, frozen and removed oldest first
+	FAI_CorpseManager CorpseManager;
+
+	// AI gunfire, traced asynchronously in one batch a frame
+	FAI_WeaponFire WeaponFire;
+	// Slots whose dead AI is already in DestroyQueue
+	TBitArray<> DestroyQueuedSlots;
+
+	// With the population budget enabled these only pick where the budget starts
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller")
+	int NumberOfThinkingCharacters = 20;
+
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller")
+	int NumberOfIntelligentCharacters = 8;
+
+	// How much each factor counts when ranking AI for the tiers
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Importance")
+	FAI_ImportanceWeights ImportanceWeights;
+
+	// Pause animations of AI outside every viewpoint's frustum
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Viewpoints")
+	bool bPauseAnimationOutOfView = true;
+
+	// AI closer than this to a viewpoint keep animating even out of view (shadows, turning around)
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Viewpoints", meta = (ClampMin = 0))
+	float OutOfViewAnimationDistance = 600.f;
+
+	// Radius added around the AI for the frustum test
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Viewpoints", meta = (ClampMin = 0))
+	float FrustumPadding = 150.f;
+
+	// Bands for the Normal tier
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Hysteresis")
+	FAI_LODBand IntelligentBand;
+
+	// Bands for the Basic tier, an AI past these is put to Sleep
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Hysteresis")
+	FAI_LODBand ThinkingBand;
+
+	// Bands for animation rendering, RankSlack is not used
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Hysteresis")
+	FAI_LODBand RenderingBand;
+
+	// Raises or lowers the thinking counts and distances between its bounds from measured frame times
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Budget")
+	FAI_PopulationBudgetSettings PopulationBudget;
+
+	// Shadows, mesh LOD and weapons of far and out of view AI
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Rendering")
+	FAI_RenderCostSettings RenderCost;
+
+	// Animation of rendered AI per controller tier
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Animation")
+	FAI_AnimationTier NormalAnimation = FAI_AnimationTier(0, 0, false, false);
+
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Animation")
+	FAI_AnimationTier BasicAnimation = FAI_AnimationTier(2, 1, true, true);
+
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Animation")
+	FAI_AnimationTier SleepAnimation = FAI_AnimationTier(4, 2, true, true);
+
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Animation")
+	FAI_AnimationBudget AnimationBudget;
+
+	// Frames the animation budget currently adds to Basic and Sleep
+	UPROPERTY(VisibleInstanceOnly, Category = "AI Level Controller|Animation")
+	int32 CurrentAnimationExtraFrameSkip = 0;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "AI Level Controller|Budget")
+	int32 CurrentThinkingCharacters = 0;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "AI Level Controller|Budget")
+	int32 CurrentIntelligentCharacters = 0;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "AI Level Controller|Budget")
+	float CurrentDistanceScale = 1.f;
+
+	// Most AI of one class kept in the pool, more are destroyed
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Pool", meta = (ClampMin = 0))
+	int32 MaxPooledPerClass = 64;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "AI Level Controller|Stats")
+	int32 PoolHits = 0;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "AI Level Controller|Stats")
+	int32 PoolMisses = 0;
+
+	// Time per frame spent on queued spawns and despawns, at least one of each is tried every frame
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Per Tick", meta = (ClampMin = 0))
+	float SpawnBudgetMicroseconds = 1000.f;
+
+	// Size of a spatial grid cell, about the usual query radius keeps queries to a few cells
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller", meta = (ClampMin = 100))
+	float SpatialGridCellSize = 1000.f;
+
+	// The player's gunshots, and AI gunfire from AI with bAlertOnGunfire
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Alerts")
+	FAI_AlertSettings GunshotAlert;
+
+	// Only pushed by AI with bAlertOnDamage
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Alerts")
+	FAI_AlertSettings DamageAlert = FAI_AlertSettings(600.f, 1.f, 0.1f);
+
+	// Radius is usually overridden by the AI's NotifyRadius
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Alerts")
+	FAI_AlertSettings SightingAlert = FAI_AlertSettings(1000.f, 1.f, 0.f);
+
+	// Alerts of the same kind closer than this in one frame are merged
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Alerts", meta = (ClampMin = 0))
+	float AlertMergeDistance = 300.f;
+
+	// AI sounds playing at once over every category, also the number of pooled audio components
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Audio", meta = (ClampMin = 0))
+	int32 MaxAIVoices = 12;
+
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Audio")
+	FAI_SoundCategorySettings DeathAudio = FAI_SoundCategorySettings(4, 4.f, 5000.f);
+
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Audio")
+	FAI_SoundCategorySettings DamageAudio = FAI_SoundCategorySettings(4, 3.f, 4000.f);
+
+	// Sword swings and gunfire
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Audio")
+	FAI_SoundCategorySettings CombatAudio = FAI_SoundCategorySettings(6, 2.f, 4000.f);
+
+	// Ragdoll budget and corpse cap
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Corpses")
+	FAI_CorpseSettings Corpses;
+
+	// Channel the AI's shots are traced on
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Weapons")
+	TEnumAsByte<ECollisionChannel> ShotTraceChannel = ECC_Pawn;
+
+	// Deferred spawns finished per frame, each runs the AI's construction scripts and BeginPlay
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Per Tick", meta = (ClampMin = 1))
+	int32 MaxFinishSpawningPerTick = 2;
+
+	// A dormant spawner's flock spawns when a viewpoint comes within this distance
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Spawning", meta = (ClampMin = 0))
+	float SpawnerActivateDistance = 8000.f;
+
+	// An active spawner's flock despawns when every viewpoint is further away than this
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Spawning", meta = (ClampMin = 0))
+	float SpawnerDeactivateDistance = 10000.f;
+
+	// Seconds between activation checks
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Spawning", meta = (ClampMin = 0, Units = "s"))
+	float SpawnerActivationInterval = 0.5f;
+
+	// Flocks are not activated past this many registered AI, 0 is unlimited
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Spawning", meta = (ClampMin = 0))
+	int32 MaxLivePawns = 150;
+
+	// A despawn waits at most this long for its AI to leave every view
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Spawning", meta = (ClampMin = 0, Units = "s"))
+	float MaxDespawnDelay = 30.f;
+
+	// LOD passes per second, 0 runs one every frame
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Per Tick", meta = (ClampMin = 0, Units = "Hz"))
+	float LODPassRate = 0.f;
+
+	// Time per frame spent applying LOD transitions and destroy requests, at least one is applied every frame
+	UPROPERTY(EditAnywhere, Category = "AI Level Controller|Per Tick", meta = (ClampMin = 0))
+	float TransitionBudgetMicroseconds = 500.f;
+};
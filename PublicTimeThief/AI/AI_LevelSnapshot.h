@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+#include "AI_LODSettings.h"
+#include <atomic>
+
+/**
+ * A camera the AI are ranked against, split-screen players and spectator cameras each add one
+ */
+struct FAI_Viewpoint
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Forward = FVector::ForwardVector;
+	FVector Right = FVector::RightVector;
+	FVector Up = FVector::UpVector;
+
+	float TanHalfHorizontalFOV = 1.f;
+	float TanHalfVerticalFOV = 1.f;
+
+	void Set(const FVector& InLocation, const FRotator& Rotation, const float HorizontalFOV, const float AspectRatio)
+	{
+		Location = InLocation;
+
+		const FRotationMatrix Axes(Rotation);
+		Forward = Axes.GetUnitAxis(EAxis::X);
+		Right = Axes.GetUnitAxis(EAxis::Y);
+		Up = Axes.GetUnitAxis(EAxis::Z);
+
+		TanHalfHorizontalFOV = FMath::Tan(FMath::DegreesToRadians(HorizontalFOV * 0.5f));
+		TanHalfVerticalFOV = TanHalfHorizontalFOV / FMath::Max(AspectRatio, UE_KINDA_SMALL_NUMBER);
+	}
+
+	// Is a sphere at Point with Radius inside the view pyramid (no near or far plane)
+	bool IsInFrustum(const FVector& Point, const float Radius) const
+	{
+		const FVector Offset = Point - Location;
+		const float Depth = Offset | Forward;
+		if (Depth < -Radius)
+			return false;
+
+		return FMath::Abs(Offset | Right) <= Depth * TanHalfHorizontalFOV + Radius
+			&& FMath::Abs(Offset | Up) <= Depth * TanHalfVerticalFOV + Radius;
+	}
+};
+
+/**
+ * Copy of everything the LOD pass needs to know about the AI, taken on the game thread once per frame
+ * Slots match the Level Controller's registry, a free slot has a null Pawn and is not alive
+ */
+struct FAI_LevelSnapshot
+{
+	// Increases by one every time a snapshot is published
+	uint64 Version = 0;
+
+	// World time the snapshot was taken at
+	double WorldTime = 0.0;
+
+	// Counts and bands to rank this snapshot with
+	FAI_LODSettings Settings;
+
+	// Scores every AI, shared so publishing does not copy the function
+	TSharedPtr<const FAI_ImportanceFunction, ESPMode::ThreadSafe> ImportanceFunction;
+
+	// Every local player's camera and registered spectator camera, AI are scored by their best one
+	TArray<FAI_Viewpoint> Viewpoints;
+
+	// Handle of the AI in each registry slot, unset for free slots
+	TArray<FAI_PawnHandle> Handles;
+	TArray<FVector> Positions;
+	TArray<uint8> AliveFlags;
+	TArray<TEnumAsByte<EControllerStatus::EType>> Statuses;
+	TArray<uint8> RenderingFlags;
+	TArray<uint8> RecentlyRenderedFlags;
+	TArray<uint8> KnownHostileFlags;
+	TArray<EAI_ImportanceState::EType> ImportanceStates;
+
+	FORCEINLINE int32 Num() const { return Handles.Num(); }
+
+	// Sizes every array to NumSlots, keeps the allocations
+	void SetNumSlots(const int32 NumSlots)
+	{
+		Handles.SetNumUninitialized(NumSlots, false);
+		Positions.SetNumUninitialized(NumSlots, false);
+		AliveFlags.SetNumUninitialized(NumSlots, false);
+		Statuses.SetNumUninitialized(NumSlots, false);
+		RenderingFlags.SetNumUninitialized(NumSlots, false);
+		RecentlyRenderedFlags.SetNumUninitialized(NumSlots, false);
+		KnownHostileFlags.SetNumUninitialized(NumSlots, false);
+		ImportanceStates.SetNumUninitialized(NumSlots, false);
+	}
+};
+
+/**
+ * Two snapshots, the game thread writes the one the LOD pass is not reading then flips
+ * If the LOD pass is still holding the back buffer the publish is skipped for that frame
+ */
+class FAI_LevelSnapshotBuffer
+{
+public:
+	// Game Thread: returns the buffer to fill, or nullptr if the reader still holds it
+	FAI_LevelSnapshot* BeginWrite()
+	{
+		const int32 Back = PublishedIndex.load() == 0 ? 1 : 0;
+		if (ReadingIndex.load() == Back)
+			return nullptr;
+
+		WritingIndex = Back;
+		return &Snapshots[Back];
+	}
+
+	// Game Thread: stamps and publishes the buffer returned by BeginWrite
+	void EndWrite()
+	{
+		check(WritingIndex != INDEX_NONE);
+
+		Snapshots[WritingIndex].Version = ++Version;
+		PublishedIndex.store(WritingIndex);
+		WritingIndex = INDEX_NONE;
+	}
+
+	// LOD pass: returns the latest snapshot and holds it until Release, nullptr if nothing is published yet
+	const FAI_LevelSnapshot* Acquire()
+	{
+		int32 Index;
+		do
+		{
+			Index = PublishedIndex.load();
+			if (Index == INDEX_NONE)
+				return nullptr;
+
+			ReadingIndex.store(Index);
+		}
+		// The writer may have flipped before it saw our claim, try again on the new front buffer
+		while (PublishedIndex.load() != Index);
+
+		return &Snapshots[Index];
+	}
+
+	// LOD pass: lets the game thread write over the acquired snapshot again
+	void Release()
+	{
+		ReadingIndex.store(INDEX_NONE);
+	}
+
+private:
+	FAI_LevelSnapshot Snapshots[2];
+
+	std::atomic<int32> PublishedIndex{ INDEX_NONE };
+	std::atomic<int32> ReadingIndex{ INDEX_NONE };
+
+	int32 WritingIndex = INDEX_NONE;
+	uint64 Version = 0;
+};
@@ -1,7 +1,9 @@
 #include "AI_PawnBase.h"
+#include "Animation/AnimMontage.h"
 #include "BaseSword.h"
 #include "BehaviorTree/BlackboardComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "Components/ChildActorComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "ProjectTimeThief/AI/Brain/AI_ControllerBase.h"
 #include "ProjectTimeThief/AI/Brain/AI_StateManager.h"
@@ -11,8 +13,8 @@
 // Sets default values
 AAI_PawnBase::AAI_PawnBase()
 {
-	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Scores reach the blackboard through the Level Controller, the AI itself never ticks
+	PrimaryActorTick.bCanEverTick = false;
 
 	// Setup Character Components
 	CapsuleComponent = CreateDefaultSubobject<UCapsuleComponent>(TEXT("Capsule Component"));
@@ -23,6 +25,8 @@ AAI_PawnBase::AAI_PawnBase()
 	MeshComponent = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Character Mesh"));
 	MeshComponent->SetupAttachment(RootComponent);
 	MeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	// Update rate parameters are only made for meshes registered with this on, the Level Controller sets the rate
+	MeshComponent->bEnableUpdateRateOptimizations = true;
 
 	ArrowComponent = CreateDefaultSubobject<UArrowComponent>(TEXT("Arrow Component"));
 	ArrowComponent->SetupAttachment(RootComponent);
@@ -42,69 +46,65 @@ void AAI_PawnBase::BeginPlay()
 
 	Super::BeginPlay();
 
-	if (AIController)
-		AIController->GetBlackboardComponent()->SetValueAsFloat(FName("Time Since Destroy"), -1.f);
-
 	// Setup Notifier Component
 	{
 		Notifier = Cast<USphereComponent>(GetDefaultSubobjectByName(TEXT("Notifier Component")));
 
+		// Only its radius is used, who is inside it is asked of the Level Controller's spatial grid
 		if (IsValid(Notifier))
 		{
-			Notifier->OnComponentBeginOverlap.AddDynamic(this, &AAI_PawnBase::OnNotifierBeginOverlap);
-			Notifier->OnComponentEndOverlap.AddDynamic(this, &AAI_PawnBase::OnNotifierEndOverlap);
+			NotifyRadius = Notifier->GetScaledSphereRadius();
+			Notifier->SetGenerateOverlapEvents(false);
+			Notifier->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 		}
 	}
 
-	// Make sure Sword or Gun pointer is set
+	// Make sure Sword or Gun pointer is set, weapons are direct child actors so only our own components are looked at
 	if(!Sword || !Gun)
 	{
-		TArray<AActor*> OutChildren;
-		GetAllChildActors(OutChildren);
+		TInlineComponentArray<UChildActorComponent*> ChildActorComponents(this);
 
-		for(AActor* Actor : OutChildren)
+		for(const UChildActorComponent* ChildActorComponent : ChildActorComponents)
 		{
-			if(Actor->IsA(ABaseSword::StaticClass()))
-			{
+			AActor* Actor = ChildActorComponent->GetChildActor();
+
+			if(!Sword)
 				Sword = Cast<ABaseSword>(Actor);
-			}
-			if(Actor->IsA(AGunBase::StaticClass()))
-			{
+			if(!Gun)
 				Gun = Cast<AGunBase>(Actor);
-			}
+
+			if(Sword && Gun)
+				break;
 		}
 	}
 
 	AnimInstance = MeshComponent->GetAnimInstance();
+
+	GetComponents<USkeletalMeshComponent>(SkeletalMeshes);
+
+	DefaultCapsuleCollision = CapsuleComponent->GetCollisionEnabled();
+	DefaultCapsuleResponses = CapsuleComponent->GetCollisionResponseToChannels();
+	DefaultMeshRelativeTransform = MeshComponent->GetRelativeTransform();
+
+	ApplySpawnTier();
 }
 
-// Called every frame
-void AAI_PawnBase::Tick(float DeltaTime)
+void AAI_PawnBase::ResetTimeSinceDestroy()
 {
-	Super::Tick(DeltaTime);
+	if (AAI_LevelController* LevelController = RegisteredLevelController.Get())
+		LevelController->SetTimeSinceDestroy(PawnHandle, -1.f);
+}
 
-	if (AIController)
-	{
-		if (UBlackboardComponent* Blackboard = AIController->GetBlackboardComponent(); IsValid(Blackboard) && bIsThinking)
-		{
-			Blackboard->SetValueAsFloat(HealthKey, Health);
-			Blackboard->SetValueAsFloat(FearKey, Fear);
-			Blackboard->SetValueAsFloat(ConfidenceKey, Confidence);
-			Blackboard->SetValueAsFloat(SusKey, Suspicion);
+void AAI_PawnBase::ZeroTimeSinceDestroy()
+{
+	if (AAI_LevelController* LevelController = RegisteredLevelController.Get())
+		LevelController->SetTimeSinceDestroy(PawnHandle, 0.f);
+}
 
-			// If the AI was recently in the destroy state
-			if (TimeSinceDestroy >= 0.f)
-			{
-				TimeSinceDestroy += DeltaTime;
-				// Reset TimeSinceDestroy after a set amount of time (TimeToForgetDestroy)
-				if (TimeSinceDestroy >= TimeToForgetDestroy)
-				{
-					ResetTimeSinceDestroy();
-				}
-				Blackboard->SetValueAsFloat(FName("Time Since Destroy"), TimeSinceDestroy);
-			}
-		}
-	}
+float AAI_PawnBase::GetTimeSinceDestroy() const
+{
+	const AAI_LevelController* LevelController = RegisteredLevelController.Get();
+	return LevelController ? LevelController->GetTimeSinceDestroy(PawnHandle) : -1.f;
 }
 
 // Called to bind functionality to input
@@ -166,22 +166,40 @@ void AAI_PawnBase::RespondTo(FVector RespondToLocation)
 
 }
 
-void AAI_PawnBase::OnNotifierBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
-	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AAI_PawnBase::PlayAISound(const EAI_SoundCategory::EType Category, const TArray<USoundWave*>& Sounds, const float Pitch)
 {
-	if (AAI_PawnBase* PawnBase = Cast<AAI_PawnBase>(OtherActor); OtherActor != this && IsValid(PawnBase))
+	if (Sounds.Num() == 0)
+		return;
+
+	FAI_SoundRequest Request;
+	Request.Sound = Sounds[FMath::RandRange(0, Sounds.Num() - 1)];
+	Request.Attenuation = AttenuationClass;
+	Request.Location = GetActorLocation();
+	Request.Volume = SoundClass ? SoundClass->Properties.Volume : 1.f;
+	Request.Pitch = Pitch;
+	Request.Category = Category;
+
+	if (AAI_LevelController* LevelController = RegisteredLevelController.Get())
 	{
-		NotifiedActors.Emplace(PawnBase);
+		LevelController->QueueSound(Request);
+	}
+	else
+	{
+		UGameplayStatics::PlaySoundAtLocation(GetWorld(), Request.Sound, Request.Location, GetActorRotation(),
+			Request.Volume, Pitch, 0, AttenuationClass);
 	}
 }
 
-void AAI_PawnBase::OnNotifierEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
-	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+void AAI_PawnBase::NotifyNearbyAI(const FVector NotifyLocation)
 {
-	if (const AAI_PawnBase* PawnBase = Cast<AAI_PawnBase>(OtherActor); IsValid(PawnBase))
-	{
-		NotifiedActors.Remove(PawnBase);
-	}
+	if (AAI_LevelController* LevelController = RegisteredLevelController.Get())
+		LevelController->PushAlert(EAI_AlertType::Sighting, NotifyLocation, this, nullptr, NotifyRadius);
+}
+
+int32 AAI_PawnBase::GetNotifiedActors(TArray<AAI_PawnBase*>& OutActors) const
+{
+	const AAI_LevelController* LevelController = RegisteredLevelController.Get();
+	return LevelController ? LevelController->QueryAIInRadius(GetActorLocation(), NotifyRadius, OutActors, this) : 0;
 }
 
 void AAI_PawnBase::SetEnableThinking(const bool bSet, const TEnumAsByte<EControllerStatus::EType> ControllerStatus)
@@ -199,31 +217,47 @@ void AAI_PawnBase::SetEnableRendering(const bool bSet)
 
 void AAI_PawnBase::ChangeThinkingStatus(bool bSet, const TEnumAsByte<EControllerStatus::EType> ControllerStatus)
 {
-	bIsThinking = bSet;
-	StateManager->SetComponentTickEnabled(bSet);
-	MovementComponent->SetComponentTickEnabled(bSet);
+	if (bSet)
+	{
+		for (uint8 Stage = 0; Stage < EWakeStage::Num; Stage++)
+			ApplyWakeStage(static_cast<EWakeStage::EType>(Stage), ControllerStatus);
+		return;
+	}
+
+	bIsThinking = false;
+	StateManager->SetComponentTickEnabled(false);
+	MovementComponent->SetComponentTickEnabled(false);
 
 	if (AIController)
+		AIController->SetEnableThinking(false, EControllerStatus::Sleep);
+
+	if (!bIsDead)
+		SetPhysicsSleeping(true);
+}
+
+void AAI_PawnBase::ApplyWakeStage(const EWakeStage::EType Stage, const TEnumAsByte<EControllerStatus::EType> ControllerStatus)
+{
+	switch (Stage)
 	{
-		switch (ControllerStatus)
-		{
-		case EControllerStatus::Sleep:
-			Notifier->SetComponentTickEnabled(false);
-			AIController->SetEnableThinking(false, ControllerStatus);
-			break;
-		case EControllerStatus::Basic:
-			Notifier->SetComponentTickEnabled(false);
+	case EWakeStage::Perception:
+		// Perception and the Controller Status on the Blackboard
+		if (AIController)
 			AIController->SetEnableThinking(true, ControllerStatus);
-			MovementComponent->SetComponentTickInterval(0.05f);
-			break;
-		case EControllerStatus::Normal:
-			Notifier->SetComponentTickEnabled(true);
-			AIController->SetEnableThinking(true, ControllerStatus);
-			MovementComponent->SetComponentTickInterval(0.03f);
-			break;
-		default:
-			break;
-		}
+		break;
+	case EWakeStage::Brain:
+		// State Manager drives the Behavior Tree's State
+		bIsThinking = true;
+		StateManager->SetComponentTickEnabled(true);
+		break;
+	case EWakeStage::Movement:
+		// Bodies are back before the AI moves
+		SetPhysicsSleeping(false);
+		MovementComponent->SetComponentTickEnabled(true);
+		if (AIController)
+			MovementComponent->SetComponentTickInterval(ControllerStatus == EControllerStatus::Normal ? 0.03f : 0.05f);
+		break;
+	default:
+		break;
 	}
 }
 
@@ -232,24 +266,135 @@ void AAI_PawnBase::ChangeRenderingStatus(bool bSet)
 {
 	bIsRendering = bSet;
 
-	TArray<UActorComponent*> OutComponents;
-	GetComponents(USkeletalMeshComponent::StaticClass(), OutComponents);
-
-	for (UActorComponent* Component : OutComponents)
+	for (USkeletalMeshComponent* SKMeshComponent : SkeletalMeshes)
 	{
-		USkeletalMeshComponent* SKMeshComponent = Cast<USkeletalMeshComponent>(Component);
-
 		// Set to True if Render Status(bSet) is False vis versa
 		SKMeshComponent->bPauseAnims = !bSet; 
+	}
 
-		if(bSet)
-		{
-			SKMeshComponent->SetCollisionProfileName(TEXT("CharacterMesh"));
-		}
-		else
+	UpdateMeshCollision();
+}
+
+void AAI_PawnBase::SetPhysicsSleeping(const bool bSleeping)
+{
+	if (bPhysicsSleeping == bSleeping)
+		return;
+
+	bPhysicsSleeping = bSleeping;
+	ApplyPhysicsTier();
+}
+
+void AAI_PawnBase::ApplyPhysicsTier()
+{
+	if (bIsDead || bIsInPool)
+		return;
+
+	if (!bPhysicsSleeping)
+	{
+		CapsuleComponent->SetCollisionEnabled(DefaultCapsuleCollision);
+		CapsuleComponent->SetCollisionResponseToChannels(DefaultCapsuleResponses);
+	}
+	else if (SleepCapsuleCollision == ESleepCollision::PawnsOnly)
+	{
+		CapsuleComponent->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+		CapsuleComponent->SetCollisionResponseToAllChannels(ECR_Ignore);
+		CapsuleComponent->SetCollisionResponseToChannel(ECC_Pawn, ECR_Block);
+	}
+	else if (SleepCapsuleCollision == ESleepCollision::Disabled)
+	{
+		CapsuleComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+
+	UpdateMeshCollision();
+}
+
+void AAI_PawnBase::UpdateMeshCollision()
+{
+	// Sleep and rendering are decided apart, a sleeping AI on screen can still be shot
+	const bool bCollide = bIsRendering;
+
+	for (USkeletalMeshComponent* SKMeshComponent : SkeletalMeshes)
+	{
+		SKMeshComponent->SetCollisionProfileName(bCollide ? TEXT("CharacterMesh") : TEXT("NoCollision"));
+
+		// Without collision no physics state is made, so this only removes or brings back the bodies
+		// A ragdoll keeps its bodies until it is pooled or destroyed
+		if (SKMeshComponent->IsPhysicsStateCreated() != bCollide && !SKMeshComponent->IsSimulatingPhysics())
+			SKMeshComponent->RecreatePhysicsState();
+	}
+}
+
+int32 AAI_PawnBase::GetNumActivePhysicsBodies() const
+{
+	int32 NumBodies = CapsuleComponent->IsPhysicsStateCreated() && CapsuleComponent->IsCollisionEnabled() ? 1 : 0;
+
+	for (const USkeletalMeshComponent* SKMeshComponent : SkeletalMeshes)
+	{
+		if (SKMeshComponent->IsPhysicsStateCreated())
+			NumBodies += SKMeshComponent->Bodies.Num();
+	}
+	return NumBodies;
+}
+
+void AAI_PawnBase::SetRenderCost(const bool bCastShadows, const int32 ForcedLOD, const bool bShowWeapons)
+{
+	if (HasRenderCost(bCastShadows, ForcedLOD, bShowWeapons))
+		return;
+
+	bRenderCostSet = true;
+	bRenderCastShadows = bCastShadows;
+	RenderForcedLOD = ForcedLOD;
+	bRenderShowWeapons = bShowWeapons;
+
+	for (USkeletalMeshComponent* SKMeshComponent : SkeletalMeshes)
+	{
+		// Both are read when the proxy is made, so one recreate covers them
+		const bool bShadowChanged = SKMeshComponent->CastShadow != bCastShadows;
+		SKMeshComponent->CastShadow = bCastShadows;
+		SKMeshComponent->SetForcedLOD(ForcedLOD);
+
+		if (bShadowChanged)
+			SKMeshComponent->MarkRenderStateDirty();
+	}
+
+	// Dead and pooled AI keep their weapons hidden
+	if (bIsDead || bIsInPool)
+		return;
+
+	if (Sword)
+		Sword->SetActorHiddenInGame(!bShowWeapons);
+	if (Gun)
+		Gun->SetActorHiddenInGame(!bShowWeapons);
+}
+
+void AAI_PawnBase::SetAnimationLOD(const int32 FrameSkip, const int32 MinLOD, const bool bInterpolateSkippedFrames,
+	const bool bOnlyTickPoseWhenRendered)
+{
+	if (FrameSkip == AnimationFrameSkip && MinLOD == AnimationMinLOD && bInterpolateSkippedFrames == bAnimationInterpolate
+		&& bOnlyTickPoseWhenRendered == bAnimationOnlyTickPoseWhenRendered)
+		return;
+
+	AnimationFrameSkip = FrameSkip;
+	AnimationMinLOD = MinLOD;
+	bAnimationInterpolate = bInterpolateSkippedFrames;
+	bAnimationOnlyTickPoseWhenRendered = bOnlyTickPoseWhenRendered;
+
+	for (USkeletalMeshComponent* SKMeshComponent : SkeletalMeshes)
+	{
+		// The same skip at every LOD, so the tier alone decides the rate
+		if (FAnimUpdateRateParameters* UpdateRateParams = SKMeshComponent->AnimUpdateRateParams)
 		{
-			SKMeshComponent->SetCollisionProfileName(TEXT("NoCollision"));
+			UpdateRateParams->bShouldUseLodMap = true;
+			UpdateRateParams->LODToFrameSkipMap.Reset();
+			for (int32 LOD = 0; LOD < MAX_SKELETAL_MESH_LODS; LOD++)
+				UpdateRateParams->LODToFrameSkipMap.Add(LOD, FrameSkip);
+			UpdateRateParams->bInterpolateSkippedFrames = bInterpolateSkippedFrames;
 		}
+
+		SKMeshComponent->SetMinLOD(MinLOD);
+		SKMeshComponent->VisibilityBasedAnimTickOption = bOnlyTickPoseWhenRendered
+			? EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered
+			: EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
 	}
 }
 
@@ -279,9 +424,7 @@ float AAI_PawnBase::TakeDamage(float DamageAmount, FDamageEvent const& DamageEve
 		// Handle Death
 		BeginToDie(-Direction, Hit.Location);
 
-		int32 SoundIndex = FMath::RandRange(0, DeathSounds.Num() - 1);
-		UGameplayStatics::PlaySoundAtLocation(GetWorld(), DeathSounds[SoundIndex], GetActorLocation(),
-			GetActorRotation(), SoundClass->Properties.Volume, 1, 0, AttenuationClass);
+		PlayAISound(EAI_SoundCategory::Death, DeathSounds);
 	}
 	else
 	{
@@ -291,12 +434,15 @@ float AAI_PawnBase::TakeDamage(float DamageAmount, FDamageEvent const& DamageEve
 		Suspicion += 99.99999f;
 
 		// Respond to a location in the direction of the shot
-		RespondTo(GetActorLocation() - ((GetActorLocation() - DamageCauser->GetActorLocation()) * 0.8f));
+		const FVector ShotLocation = GetActorLocation() - ((GetActorLocation() - DamageCauser->GetActorLocation()) * 0.8f);
+		AAI_LevelController* LevelController = RegisteredLevelController.Get();
+		if (bAlertOnDamage && LevelController)
+			LevelController->PushAlert(EAI_AlertType::Damage, ShotLocation, nullptr, this);
+		else
+			RespondTo(ShotLocation);
 
 		// Play a Damage Sound
-		int32 SoundIndex = FMath::RandRange(0, DamageSounds.Num() - 1);
-		UGameplayStatics::PlaySoundAtLocation(GetWorld(), DamageSounds[SoundIndex], GetActorLocation(),
-			GetActorRotation(), SoundClass->Properties.Volume, 1, 0, AttenuationClass);
+		PlayAISound(EAI_SoundCategory::Damage, DamageSounds);
 	}
 
 	return DamageTaken;
@@ -308,33 +454,53 @@ void AAI_PawnBase::BeginToDie(FVector DirectionToDie, FVector HitLocation)
 	{
 		GEngine->AddOnScreenDebugMessage(-1, 3, FColor::Red, "Direction to die: " + DirectionToDie.ToCompactString());
 
-		// Un-possess and get rid of of controller
-		if(AIController)
+		if (PoolOwner.IsValid())
 		{
-			AIController->UnPossess();
-			AIController->Destroy();
+			// Pooled AI keep their controller and components so they can be spawned again, they are only switched off
+			ChangeThinkingStatus(false);
+			MovementComponent->StopMovementImmediately();
+			CapsuleComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+			if (Sword)
+				Sword->SetActorHiddenInGame(true);
+			if (Gun)
+				Gun->SetActorHiddenInGame(true);
 		}
+		else
+		{
+			// Un-possess and get rid of of controller
+			if(AIController)
+			{
+				AIController->UnPossess();
+				AIController->Destroy();
+			}
 
-		// Destroy Components except Mesh
-		TArray<UActorComponent*> PawnComponents;
-		GetComponents(PawnComponents);
+			// Destroy Components except Mesh
+			TArray<UActorComponent*> PawnComponents;
+			GetComponents(PawnComponents);
 
-		for (UActorComponent* Component : PawnComponents)
-		{
-			if (Component->GetClass() != USkeletalMeshComponent::StaticClass())
-				Component->DestroyComponent(true);
+			for (UActorComponent* Component : PawnComponents)
+			{
+				if (Component->GetClass() != USkeletalMeshComponent::StaticClass())
+					Component->DestroyComponent(true);
+			}
 		}
 
 
-		// Ragdoll Mesh and Set Mesh to Collide with everything
-		MeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-		MeshComponent->SetCollisionProfileName(TEXT("Ragdoll"));
-		MeshComponent->SetSimulatePhysics(true);
-		// MeshComponent->AddImpulseToAllBodiesBelow(DirectionToDie * 700.f);
-		MeshComponent->bPauseAnims = true;
+		// The Level Controller limits how many ragdolls simulate, the rest play a death animation
+		if (AAI_LevelController* LevelController = RegisteredLevelController.Get())
+		{
+			const float AnimationLength = LevelController->CanAddRagdoll() ? 0.f : PlayDeathAnimation();
+			if (LevelController->AddCorpse(this, AnimationLength))
+				StartRagdoll();
+		}
+		else
+		{
+			StartRagdoll();
 
-		// Start Event to Disable Ragdoll and lock the position
-		GetWorld()->GetTimerManager().SetTimer(StopRagdollTimerHandle, this, &AAI_PawnBase::StopRagdoll, 2.0f, false);
+			// Start Event to Disable Ragdoll and lock the position
+			GetWorld()->GetTimerManager().SetTimer(StopRagdollTimerHandle, this, &AAI_PawnBase::StopRagdoll, 2.0f, false);
+		}
 
 		bIsDead = true;
 
@@ -362,8 +528,6 @@ void AAI_PawnBase::StopRagdoll()
 		MeshComponent->PutAllRigidBodiesToSleep();
 		MeshComponent->SetComponentTickEnabled(false);
 
-		SetActorTickEnabled(false);
-
 		GetWorld()->GetTimerManager().ClearTimer(StopRagdollTimerHandle);
 	}
 	else
@@ -372,6 +536,57 @@ void AAI_PawnBase::StopRagdoll()
 	}
 }
 
+void AAI_PawnBase::StartRagdoll()
+{
+	// Ragdoll Mesh and Set Mesh to Collide with everything
+	MeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	MeshComponent->SetCollisionProfileName(TEXT("Ragdoll"));
+	// A sleeping AI's mesh has no bodies to ragdoll
+	if (!MeshComponent->IsPhysicsStateCreated())
+		MeshComponent->RecreatePhysicsState();
+	MeshComponent->SetSimulatePhysics(true);
+	// MeshComponent->AddImpulseToAllBodiesBelow(DirectionToDie * 700.f);
+	MeshComponent->bPauseAnims = true;
+}
+
+float AAI_PawnBase::PlayDeathAnimation()
+{
+	if (!AnimInstance || DeathMontages.Num() == 0)
+		return 0.f;
+
+	UAnimMontage* DeathMontage = DeathMontages[FMath::RandRange(0, DeathMontages.Num() - 1)];
+	if (!DeathMontage)
+		return 0.f;
+
+	MeshComponent->bPauseAnims = false;
+	const float Length = AnimInstance->Montage_Play(DeathMontage);
+	if (Length <= 0.f)
+		return 0.f;
+
+	// Frozen before the blend out takes it back to the idle pose
+	return FMath::Max(Length - DeathMontage->BlendOut.GetBlendTime(), KINDA_SMALL_NUMBER);
+}
+
+bool AAI_PawnBase::IsRagdollSettled(const float SettleSpeed) const
+{
+	return !MeshComponent->IsSimulatingPhysics() || MeshComponent->GetPhysicsLinearVelocity().Size() < SettleSpeed;
+}
+
+void AAI_PawnBase::FreezeCorpse()
+{
+	GetWorld()->GetTimerManager().ClearTimer(StopRagdollTimerHandle);
+
+	// The bones keep their last transforms, nothing evaluates them again until the AI is pooled
+	MeshComponent->bNoSkeletonUpdate = true;
+	MeshComponent->bPauseAnims = true;
+	MeshComponent->PutAllRigidBodiesToSleep();
+	MeshComponent->SetSimulatePhysics(false);
+	MeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	if (MeshComponent->IsPhysicsStateCreated())
+		MeshComponent->RecreatePhysicsState();
+	MeshComponent->SetComponentTickEnabled(false);
+}
+
 void AAI_PawnBase::StartDestroyTimer()
 {
 	GetWorld()->GetTimerManager().SetTimer(DestroyAfterDeathTimerHandle, this, &AAI_PawnBase::DestroyAfterDeath, 10.0f, false);
@@ -379,9 +594,128 @@ void AAI_PawnBase::StartDestroyTimer()
 
 void AAI_PawnBase::DestroyAfterDeath()
 {
+	// Pooled AI go back to be spawned again
+	if (AAI_LevelController* Pool = PoolOwner.Get(); Pool && Pool->ReleaseToPool(this))
+		return;
+
 	Destroy();
 }
 
+void AAI_PawnBase::ResetForPool()
+{
+	GetWorld()->GetTimerManager().ClearTimer(StopRagdollTimerHandle);
+	GetWorld()->GetTimerManager().ClearTimer(DestroyAfterDeathTimerHandle);
+
+	ChangeThinkingStatus(false);
+	bChangeThinkingStatusOnTick = false;
+	bChangeRenderingStatusOnTick = false;
+	MovementComponent->StopMovementImmediately();
+
+	// Out of ragdoll and back onto the capsule
+	MeshComponent->bNoSkeletonUpdate = false;
+	MeshComponent->SetSimulatePhysics(false);
+	MeshComponent->AttachToComponent(CapsuleComponent, FAttachmentTransformRules::KeepRelativeTransform);
+	MeshComponent->SetRelativeTransform(DefaultMeshRelativeTransform);
+	MeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	MeshComponent->SetComponentTickEnabled(true);
+
+	if (AnimInstance)
+		AnimInstance->StopAllMontages(0.f);
+
+	ChangeRenderingStatus(false);
+
+	// Scores, memory and spawner setup back to the class defaults
+	const AAI_PawnBase* Defaults = GetClass()->GetDefaultObject<AAI_PawnBase>();
+	Health = Defaults->Health;
+	Fear = Defaults->Fear;
+	Confidence = Defaults->Confidence;
+	Suspicion = Defaults->Suspicion;
+	bCatchup = Defaults->bCatchup;
+	ReversePathDirection = Defaults->ReversePathDirection;
+	bIsLeader = Defaults->bIsLeader;
+	Path = Defaults->Path;
+	CombatType = Defaults->CombatType;
+
+	TargetHostile = nullptr;
+	RespondLocation = FVector::ZeroVector;
+	LastStimuliLocation = FVector::ZeroVector;
+
+	bIsDead = false;
+	bIsShepherd = false;
+	Spawner = nullptr;
+
+	// Back on patrol when it wakes, the Level Controller no longer ranks it by its last state
+	StateManager->SwitchStateNextTick(AI_State::Patrol);
+	bReturningToPatrol = true;
+
+	if (AIController)
+	{
+		AIController->ResetForPool();
+
+		if (UBlackboardComponent* Blackboard = AIController->GetBlackboardComponent(); IsValid(Blackboard) && Blackboard->GetBlackboardAsset())
+			Blackboard->SetValueAsFloat(FName("Time Since Destroy"), -1.f);
+	}
+
+	// Hidden and inert while it waits in the pool
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+
+	if (Sword)
+		Sword->SetActorHiddenInGame(true);
+	if (Gun)
+		Gun->SetActorHiddenInGame(true);
+
+	bIsInPool = true;
+}
+
+bool AAI_PawnBase::IsReturningToPatrol()
+{
+	if (bReturningToPatrol && StateManager->GetCurrentState() == AI_State::Patrol)
+		bReturningToPatrol = false;
+
+	return bReturningToPatrol;
+}
+
+void AAI_PawnBase::WriteSpawnSetupToBlackboard()
+{
+	if (AIController)
+		AIController->WriteSpawnSetup();
+}
+
+void AAI_PawnBase::ApplySpawnTier()
+{
+	if (SpawnStatus == EControllerStatus::None)
+		return;
+
+	// Applied now rather than on tick, so the AI never runs a frame in the wrong tier
+	ChangeThinkingStatus(SpawnStatus != EControllerStatus::Sleep, SpawnStatus);
+	ChangeRenderingStatus(bSpawnRendering);
+	bChangeThinkingStatusOnTick = false;
+	bChangeRenderingStatusOnTick = false;
+
+	SpawnStatus = EControllerStatus::None;
+}
+
+void AAI_PawnBase::ActivateFromPool(const FTransform& Transform)
+{
+	SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+
+	CapsuleComponent->SetCollisionEnabled(DefaultCapsuleCollision);
+
+	SetActorEnableCollision(true);
+	SetActorHiddenInGame(false);
+
+	if (Sword)
+		Sword->SetActorHiddenInGame(bRenderCostSet && !bRenderShowWeapons);
+	if (Gun)
+		Gun->SetActorHiddenInGame(bRenderCostSet && !bRenderShowWeapons);
+
+	bIsInPool = false;
+
+	// It comes out asleep
+	ApplyPhysicsTier();
+}
+
 void AAI_PawnBase::Attack()
 {
 	if(Sword)
@@ -394,8 +728,7 @@ void AAI_PawnBase::Attack()
 
 		AnimInstance->Montage_Play(AttackMontage);
 
-		int32 SoundIndex = FMath::RandRange(0, SwordSoundArray.Num() - 1);
-		UGameplayStatics::PlaySound2D(GetWorld(), SwordSoundArray[SoundIndex], SoundClass->Properties.Volume, FMath::RandRange(0.95f, 1.05f));
+		PlayAISound(EAI_SoundCategory::Combat, SwordSoundArray, FMath::RandRange(0.95f, 1.05f));
 	}
 	else if(Gun)
 	{
@@ -421,23 +754,25 @@ void AAI_PawnBase::Attack()
 			if(ShootMontage)
 				AnimInstance->Montage_Play(ShootMontage);
 
-			FHitResult Hit;
-			FCollisionQueryParams Params;
-			Params.AddIgnoredActor(this);
-			Params.AddIgnoredActor(Gun);
-
 			const FVector ShootingVector = GetActorLocation() + (Aim - GetActorLocation()) * 2;
-			const bool bHit = GetWorld()->LineTraceSingleByChannel(Hit, GetActorLocation(), ShootingVector, ECC_Pawn, Params);
-			DrawDebugLine(GetWorld(), GetActorLocation(), ShootingVector, bHit ? FColor::Red : FColor::Blue , false, 5);
 
-			if(bHit)
+			// Traced with every other AI's shots and resolved next frame
+			if (AAI_LevelController* LevelController = RegisteredLevelController.Get())
+			{
+				if (bAlertOnGunfire)
+					LevelController->PushAlert(EAI_AlertType::Gunshot, GetActorLocation(), this);
+
+				LevelController->QueueShot(this, Gun, GetActorLocation(), ShootingVector);
+			}
+			else
 			{
-				DrawDebugPoint(GetWorld(), Hit.ImpactPoint, 10, FColor::Red, false, 5);
-				if(APawn* HitPawn = Cast<APawn>(Hit.GetActor()))
-				{
-					FPointDamageEvent DamageEvent(16.f, Hit, GetActorRotation().Vector(), nullptr);
-					HitPawn->TakeDamage(34, DamageEvent, GetController(), this);
-				}
+				FHitResult Hit;
+				FCollisionQueryParams Params;
+				Params.AddIgnoredActor(this);
+				Params.AddIgnoredActor(Gun);
+
+				const bool bHit = GetWorld()->LineTraceSingleByChannel(Hit, GetActorLocation(), ShootingVector, ECC_Pawn, Params);
+				ResolveShot(GetActorLocation(), ShootingVector, bHit ? &Hit : nullptr);
 			}
 		}
 		else if(Gun->GetMagazineAmmo() <= 0 && Gun->Reload())
@@ -450,32 +785,30 @@ void AAI_PawnBase::Attack()
 	}
 }
 
-void AAI_PawnBase::Defend()
+void AAI_PawnBase::ResolveShot(const FVector& Start, const FVector& End, const FHitResult* Hit)
 {
-	if(Sword)
+	if (bDrawShotDebug)
 	{
-		// Block
+		DrawDebugLine(GetWorld(), Start, End, Hit ? FColor::Red : FColor::Blue, false, 5);
+		if (Hit)
+			DrawDebugPoint(GetWorld(), Hit->ImpactPoint, 10, FColor::Red, false, 5);
 	}
-}
-
-//==================================
 
-FAI_PawnNotifier::FAI_PawnNotifier(TSet<AAI_PawnBase*> Characters, FVector ActorLocation)
-{
-	CharactersToNotify = Characters;
-	NotifyLocation = ActorLocation;
-}
+	if (!Hit)
+		return;
 
-FAI_PawnNotifier::~FAI_PawnNotifier()
-{
-	UE_LOG(LogTemp, Warning, TEXT("Notify Task Finished!!!"));
+	if (APawn* HitPawn = Cast<APawn>(Hit->GetActor()); IsValid(HitPawn))
+	{
+		// Along the shot, the AI may have turned since it fired
+		FPointDamageEvent DamageEvent(16.f, *Hit, (End - Start).GetSafeNormal(), nullptr);
+		HitPawn->TakeDamage(ShotDamage, DamageEvent, GetController(), this);
+	}
 }
 
-void FAI_PawnNotifier::DoWork() const
+void AAI_PawnBase::Defend()
 {
-	for (AAI_PawnBase* CharacterToNotify : CharactersToNotify)
+	if(Sword)
 	{
-		CharacterToNotify->RespondTo(NotifyLocation);
+		// Block
 	}
 }
-
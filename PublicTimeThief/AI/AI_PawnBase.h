@@ -7,8 +7,11 @@
 #include "ProjectTimeThief/AI/Navigation/NavPath.h"
 #include "ProjectTimeThief/GunBase.h"
 #include "ProjectTimeThief/AI/Base/BaseSword.h"
+#include "ProjectTimeThief/AI/Spawners/AI_AudioScheduler.h"
+#include "ProjectTimeThief/AI/Spawners/AI_PawnHandle.h"
 #include "AI_PawnBase.generated.h"
 
+class AAI_LevelController;
 class UAI_Brain;
 class UAI_StateManager;
 class UAIPerceptionComponent;
@@ -49,6 +52,30 @@ namespace EControllerStatus
 	};
 }
 
+// Parts of waking an AI, applied in order so the cost can be spread over frames
+namespace EWakeStage
+{
+	enum EType : uint8
+	{
+		Perception,
+		Brain,
+		Movement,
+		Num
+	};
+}
+
+// What a sleeping AI's capsule still collides with
+UENUM(BlueprintType)
+namespace ESleepCollision
+{
+	enum EType
+	{
+		Keep,		// Same as awake
+		PawnsOnly,	// Only blocks pawns, traces and other queries pass through
+		Disabled	// No collision at all
+	};
+}
+
 UENUM(BlueprintType)
 namespace ECombatType
 {
@@ -102,9 +129,41 @@ protected:
 	UPROPERTY(EditDefaultsOnly)
 	UAnimMontage* ReloadMontage;
 
+	// Played instead of a ragdoll when too many are simulating, frozen just before they blend out
+	UPROPERTY(EditDefaultsOnly)
+	TArray<UAnimMontage*> DeathMontages;
+
 	UPROPERTY()
 	UAnimInstance* AnimInstance;
 
+	// Every skeletal mesh of the AI, found once in BeginPlay
+	UPROPERTY()
+	TArray<USkeletalMeshComponent*> SkeletalMeshes;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Physics LOD")
+	TEnumAsByte<ESleepCollision::EType> SleepCapsuleCollision = ESleepCollision::PawnsOnly;
+
+	bool bPhysicsSleeping = false;
+	// Restored when the AI wakes
+	FCollisionResponseContainer DefaultCapsuleResponses;
+
+	// Applies the capsule collision of the physics tier, dead and pooled AI are left alone
+	void ApplyPhysicsTier();
+	// The meshes collide, and have bodies, only while the AI is rendered
+	void UpdateMeshCollision();
+
+	// Last values given to SetRenderCost
+	bool bRenderCostSet = false;
+	bool bRenderCastShadows = true;
+	int32 RenderForcedLOD = 0;
+	bool bRenderShowWeapons = true;
+
+	// Last values given to SetAnimationLOD, -1 until it is first called
+	int32 AnimationFrameSkip = -1;
+	int32 AnimationMinLOD = -1;
+	bool bAnimationInterpolate = false;
+	bool bAnimationOnlyTickPoseWhenRendered = false;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (AllowPrivateAccess = "true"), Category = "Patrol")
 	bool bIsLeader = false;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (AllowPrivateAccess = true), Category = "Patrol")
@@ -122,9 +181,6 @@ protected:
 	float FastSprintSpeed = 800.f;
 
 public:
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
@@ -134,6 +190,8 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	FORCEINLINE UAI_StateManager* GetStateManager() const { return StateManager; }
 	FORCEINLINE void SetPath(ANavPath* SetPath) { Path = SetPath; }
+	// Writes Path and Combat Type to the blackboard, for AI that were possessed before their spawner set them up
+	void WriteSpawnSetupToBlackboard();
 	FORCEINLINE ANavPath* GetPath() const { return Path; }
 
 	FORCEINLINE float GetWalkSpeed() const { return WalkSpeed; }
@@ -188,14 +246,21 @@ public:
 	FORCEINLINE FVector GetLastStimuliLocation() const { return LastStimuliLocation; }
 	FORCEINLINE void SetLastStimuliLocation(FVector const Location) { LastStimuliLocation = Location; }
 
-	FORCEINLINE void ResetTimeSinceDestroy() { TimeSinceDestroy = -1.f; }
-	FORCEINLINE void ZeroTimeSinceDestroy() { TimeSinceDestroy = 0.f; }
+	// The destroy timer is kept by the Level Controller's score manager, unregistered AI have none
+	FName TimeSinceDestroyKey = FName("Time Since Destroy");
+	void ResetTimeSinceDestroy();
+	void ZeroTimeSinceDestroy();
+	float GetTimeSinceDestroy() const;
+	FORCEINLINE float GetTimeToForgetDestroy() const { return TimeToForgetDestroy; }
 
 	FORCEINLINE USphereComponent* GetNotifier() const { return Notifier; }
-	FORCEINLINE TSet<AAI_PawnBase*> GetNotifiedActors() const { return NotifiedActors; }
+	// Appends the other AI within NotifyRadius to OutActors, returns how many were added, none while unregistered
+	int32 GetNotifiedActors(TArray<AAI_PawnBase*>& OutActors) const;
 
-	// Tell AI to respond to given location
+	// Tell AI to respond to given location, Game Thread only
 	virtual void RespondTo(FVector RespondToLocation);
+	// Alerts the other AI within NotifyRadius, they respond to NotifyLocation on the Level Controller's next tick
+	void NotifyNearbyAI(FVector NotifyLocation);
 	FORCEINLINE FVector GetRespondLocation() const { return RespondLocation; }
 
 	FORCEINLINE void SetTargetHostile(AActor* Hostile) { TargetHostile = Hostile; }
@@ -214,8 +279,25 @@ public:
 
 	// Changes Thinking Status and Controller Status
 	virtual void ChangeThinkingStatus(bool bSet, const TEnumAsByte<EControllerStatus::EType> ControllerStatus = EControllerStatus::Sleep);
+	// Applies one stage of waking into ControllerStatus(Basic, Normal), all stages together equal ChangeThinkingStatus(true)
+	virtual void ApplyWakeStage(const EWakeStage::EType Stage, const TEnumAsByte<EControllerStatus::EType> ControllerStatus);
 	// Changes Rendering Status
 	virtual void ChangeRenderingStatus(bool bSet);
+	// Simplifies the capsule while the AI sleeps, restores it when it wakes
+	void SetPhysicsSleeping(bool bSleeping);
+	FORCEINLINE bool IsPhysicsSleeping() const { return bPhysicsSleeping; }
+	// Capsule and mesh bodies of the AI in the physics scene
+	int32 GetNumActivePhysicsBodies() const;
+
+	// Sets shadow casting and the forced LOD (0 lets the engine pick) of every skeletal mesh, and shows or hides the weapons
+	// Each mesh's render state is marked dirty once, does nothing if already set so
+	void SetRenderCost(bool bCastShadows, int32 ForcedLOD, bool bShowWeapons);
+	FORCEINLINE bool HasRenderCost(const bool bCastShadows, const int32 ForcedLOD, const bool bShowWeapons) const
+	{
+		return bRenderCostSet && bCastShadows == bRenderCastShadows && ForcedLOD == RenderForcedLOD && bShowWeapons == bRenderShowWeapons;
+	}
+	// Sets the update rate and bone LOD of every skeletal mesh of the AI, does nothing if they are already set so
+	void SetAnimationLOD(int32 FrameSkip, int32 MinLOD, bool bInterpolateSkippedFrames, bool bOnlyTickPoseWhenRendered);
 
 	FORCEINLINE bool IsPossessed() const { return bIsPossessed; }
 	FORCEINLINE void SetIsPossessed(bool bSet) { bIsPossessed = bSet; }
@@ -237,6 +319,21 @@ protected:
 
 	TEnumAsByte<EControllerStatus::EType> ControllerStatusToSet = EControllerStatus::None;
 
+	FAI_PawnHandle PawnHandle;
+
+	bool bIsInPool = false;
+	// Set when pooled, until the State Manager is back in Patrol
+	bool bReturningToPatrol = false;
+
+	// None for placed AI, which start however their controller starts them
+	TEnumAsByte<EControllerStatus::EType> SpawnStatus = EControllerStatus::None;
+	bool bSpawnRendering = false;
+
+	// Restored when a pooled AI is activated, BeginToDie turns it off
+	TEnumAsByte<ECollisionEnabled::Type> DefaultCapsuleCollision = ECollisionEnabled::QueryAndPhysics;
+	// Ragdolling moves the mesh away from the capsule
+	FTransform DefaultMeshRelativeTransform;
+
 	bool bIsPossessed = false;
 
 	UPROPERTY(EditAnywhere, Category = "Search")
@@ -245,31 +342,22 @@ protected:
 	UPROPERTY()
 	AActor* TargetHostile;
 
-	UFUNCTION()
-	virtual void OnNotifierBeginOverlap(
-		UPrimitiveComponent* OverlappedComponent,
-		AActor* OtherActor,
-		UPrimitiveComponent* OtherComp,
-		int32 OtherBodyIndex,
-		bool bFromSweep,
-		const FHitResult& SweepResult);
+	// Other AI inside this are notified, taken from the Notifier's radius when it has one
+	UPROPERTY(EditAnywhere, Category = "Search")
+	float NotifyRadius = 1000.f;
 
-	UFUNCTION()
-	virtual void OnNotifierEndOverlap(
-		UPrimitiveComponent* OverlappedComponent,
-		AActor* OtherActor,
-		UPrimitiveComponent* OtherComp,
-		int32 OtherBodyIndex);
+	// The AI's gunfire alerts the AI around it
+	UPROPERTY(EditDefaultsOnly, Category = "Alerts")
+	bool bAlertOnGunfire = false;
 
-	TSet<AAI_PawnBase*> NotifiedActors;
+	// Being damaged alerts the AI around it too, the damaged AI responds either way
+	UPROPERTY(EditDefaultsOnly, Category = "Alerts")
+	bool bAlertOnDamage = false;
 
 	FVector RespondLocation;
 
 	FVector LastStimuliLocation;
 
-	// Time since the AI was in the destroy state
-	float TimeSinceDestroy = -1.f;
-
 	UPROPERTY(EditAnywhere)
 	float TimeToForgetDestroy = 45.f;
 
@@ -285,8 +373,19 @@ protected:
 	UPROPERTY(EditDefaultsOnly)
 	int32 WeaponAccuracy = 75;
 
+	UPROPERTY(EditDefaultsOnly)
+	float ShotDamage = 34.f;
+
+	// Draws every shot's trace and impact for 5 seconds
+	UPROPERTY(EditDefaultsOnly, Category = "Debug")
+	bool bDrawShotDebug = false;
+
 	
 public:
+	// Applies a traced shot's damage, Hit is the first blocking hit or null for a miss
+	// Called by the Level Controller a frame after the shot for registered AI
+	void ResolveShot(const FVector& Start, const FVector& End, const FHitResult* Hit);
+
 	FORCEINLINE TEnumAsByte <ECombatType::EType> GetCombatType() const { return CombatType; }
 	FORCEINLINE void SetCombatType(const TEnumAsByte<ECombatType::EType> NewType) { CombatType = NewType; }
 
@@ -300,6 +399,13 @@ public:
 	UPROPERTY()
 	class AAI_SpawnerBase* Spawner = nullptr;
 
+	// Handle in the Level Controller's registry, unset while not registered
+	FORCEINLINE FAI_PawnHandle GetPawnHandle() const { return PawnHandle; }
+	FORCEINLINE void SetPawnHandle(const FAI_PawnHandle Handle) { PawnHandle = Handle; }
+
+	// Level Controller the AI is registered with, its scores are written to the blackboard from there
+	TWeakObjectPtr<AAI_LevelController> RegisteredLevelController;
+
 	FTimerHandle StopRagdollTimerHandle;
 	FTimerHandle DestroyAfterDeathTimerHandle;
 
@@ -307,6 +413,31 @@ public:
 	void StartDestroyTimer();
 	void DestroyAfterDeath();
 
+	// Simulates the mesh as a ragdoll
+	void StartRagdoll();
+	// Plays one of the death montages, returns the time until its last pose, or 0 if there is none to play
+	float PlayDeathAnimation();
+	bool IsRagdollSettled(float SettleSpeed) const;
+	// Holds the corpse in its current pose without physics, animation or collision
+	void FreezeCorpse();
+
+	// Level Controller whose pool this AI goes back to instead of being destroyed, unset for placed AI
+	TWeakObjectPtr<AAI_LevelController> PoolOwner;
+
+	// Puts the AI to sleep, hides it and resets its state to its class defaults, ready to be handed out again
+	virtual void ResetForPool();
+	// Places a pooled AI at Transform and shows it, it stays asleep until the Level Controller wakes it
+	virtual void ActivateFromPool(const FTransform& Transform);
+
+	FORCEINLINE bool IsInPool() const { return bIsInPool; }
+	// True while a pooled AI's State Manager still holds the state of its last life
+	bool IsReturningToPatrol();
+
+	// Tier the AI starts in, set by its spawner before it finishes spawning or is activated from the pool
+	FORCEINLINE void SetSpawnTier(const TEnumAsByte<EControllerStatus::EType> Status, const bool bRendering) { SpawnStatus = Status; bSpawnRendering = bRendering; }
+	// Puts the AI into its spawn tier, called at the end of BeginPlay, does nothing if no tier was set
+	void ApplySpawnTier();
+
 	UFUNCTION(BlueprintCallable)
 	virtual void Attack();
 
@@ -323,6 +454,9 @@ public:
 	UFUNCTION(BlueprintPure)
 	FORCEINLINE USoundClass* GetSoundClass() const { return SoundClass; }
 
+	// Plays one of Sounds at the AI through the Level Controller's audio scheduler, it may be culled or dropped
+	void PlayAISound(EAI_SoundCategory::EType Category, const TArray<USoundWave*>& Sounds, float Pitch = 1.f);
+
 	UPROPERTY(EditDefaultsOnly, Category = "Sound")
 	TArray<USoundWave*> SwordSoundArray;
 
@@ -346,19 +480,3 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Sound|States")
 	TArray<USoundWave*> MiscSounds;
 };
-
-//=========================================
-
-class FAI_PawnNotifier : public FNonAbandonableTask
-{
-
-public:
-	TSet<AAI_PawnBase*> CharactersToNotify;
-	FVector NotifyLocation;
-
-	FAI_PawnNotifier(TSet<AAI_PawnBase*> Characters, FVector ActorLocation);
-	~FAI_PawnNotifier();
-
-	FORCEINLINE TStatId GetStatId() const { RETURN_QUICK_DECLARE_CYCLE_STAT(AI_CharacterNotifier, STATGROUP_ThreadPoolAsyncTasks); }
-	void DoWork() const;
-};
\ No newline at end of file
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Names an AI in the Level Controller's pawn registry by slot index and the generation of that slot
+ * Safe to copy between threads, only the game thread may resolve it, and a handle to a freed slot never resolves again
+ */
+struct FAI_PawnHandle
+{
+	uint32 Index = 0;
+	// 0 is never handed out, so a default handle is invalid
+	uint32 Generation = 0;
+
+	FORCEINLINE bool IsSet() const { return Generation != 0; }
+	FORCEINLINE void Reset() { Index = 0; Generation = 0; }
+
+	FORCEINLINE bool operator==(const FAI_PawnHandle& Other) const { return Index == Other.Index && Generation == Other.Generation; }
+	FORCEINLINE bool operator!=(const FAI_PawnHandle& Other) const { return !(*this == Other); }
+
+	FORCEINLINE friend uint32 GetTypeHash(const FAI_PawnHandle& Handle)
+	{
+		return HashCombineFast(Handle.Index, Handle.Generation);
+	}
+};
@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+#include "AI_PawnPool.generated.h"
+
+/**
+ * Pooled AI of one class, kept by the Level Controller so respawning does not construct new actors and controllers
+ */
+USTRUCT()
+struct FAI_PawnPoolBucket
+{
+	GENERATED_BODY()
+
+	// Hidden, sleeping AI ready to be handed out
+	UPROPERTY()
+	TArray<AAI_PawnBase*> Pawns;
+};
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_PawnRegistry.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+
+FAI_PawnHandle FAI_PawnRegistry::Add(AAI_PawnBase* Pawn)
+{
+	check(Pawn);
+
+	if (Resolve(Pawn->GetPawnHandle()) == Pawn)
+		return Pawn->GetPawnHandle();
+
+	uint32 Index;
+	if (FreeIndices.Num() > 0)
+	{
+		Index = FreeIndices.Pop(false);
+	}
+	else
+	{
+		Index = Slots.AddDefaulted();
+	}
+
+	FSlot& Slot = Slots[Index];
+	Slot.Pawn = Pawn;
+	Slot.bOccupied = true;
+
+	FAI_PawnHandle Handle;
+	Handle.Index = Index;
+	Handle.Generation = Slot.Generation;
+
+	Pawn->SetPawnHandle(Handle);
+	return Handle;
+}
+
+bool FAI_PawnRegistry::Remove(const FAI_PawnHandle Handle)
+{
+	if (!IsCurrent(Handle))
+		return false;
+
+	FSlot& Slot = Slots[Handle.Index];
+	if (AAI_PawnBase* Pawn = Slot.Pawn.Get(); Pawn && Pawn->GetPawnHandle() == Handle)
+		Pawn->SetPawnHandle(FAI_PawnHandle());
+
+	Slot.Pawn.Reset();
+	Slot.bOccupied = false;
+
+	// Every handle to this slot is stale from now on, 0 is skipped so it stays invalid
+	if (++Slot.Generation == 0)
+		Slot.Generation = 1;
+
+	FreeIndices.Add(Handle.Index);
+	return true;
+}
+
+AAI_PawnBase* FAI_PawnRegistry::Resolve(const FAI_PawnHandle Handle) const
+{
+	return IsCurrent(Handle) ? Slots[Handle.Index].Pawn.Get() : nullptr;
+}
+
+bool FAI_PawnRegistry::IsCurrent(const FAI_PawnHandle Handle) const
+{
+	return Handle.IsSet() && Slots.IsValidIndex(Handle.Index)
+		&& Slots[Handle.Index].bOccupied && Slots[Handle.Index].Generation == Handle.Generation;
+}
+
+FAI_PawnHandle FAI_PawnRegistry::GetHandle(const int32 Index) const
+{
+	FAI_PawnHandle Handle;
+	if (Slots[Index].bOccupied)
+	{
+		Handle.Index = Index;
+		Handle.Generation = Slots[Index].Generation;
+	}
+	return Handle;
+}
+
+AAI_PawnBase* FAI_PawnRegistry::GetPawn(const int32 Index) const
+{
+	return Slots[Index].bOccupied ? Slots[Index].Pawn.Get() : nullptr;
+}
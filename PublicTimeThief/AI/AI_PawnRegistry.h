@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI_PawnHandle.h"
+
+class AAI_PawnBase;
+
+/**
+ * Dense slots of registered AI, freed slots are reused with a new generation so old handles go stale
+ * Game Thread only
+ */
+class FAI_PawnRegistry
+{
+public:
+	// Takes a free slot for Pawn and stores the handle on it, returns the handle it already has if it is registered
+	FAI_PawnHandle Add(AAI_PawnBase* Pawn);
+	// Frees the slot, returns false if the handle was already stale
+	bool Remove(const FAI_PawnHandle Handle);
+
+	// The AI the handle names, nullptr if the handle is stale or the AI was destroyed
+	AAI_PawnBase* Resolve(const FAI_PawnHandle Handle) const;
+	bool IsCurrent(const FAI_PawnHandle Handle) const;
+
+	// Handle of whatever occupies Index, unset if the slot is free
+	FAI_PawnHandle GetHandle(const int32 Index) const;
+	// Resolves whatever occupies Index, nullptr if free or destroyed
+	AAI_PawnBase* GetPawn(const int32 Index) const;
+	FORCEINLINE bool IsOccupied(const int32 Index) const { return Slots[Index].bOccupied; }
+
+	// Number of slots, free ones included, every slot index is below this
+	FORCEINLINE int32 Num() const { return Slots.Num(); }
+	FORCEINLINE int32 NumRegistered() const { return Slots.Num() - FreeIndices.Num(); }
+
+	void Reserve(const int32 Number) { Slots.Reserve(Number); }
+
+private:
+	struct FSlot
+	{
+		// Weak so an AI destroyed without being removed still reads as gone
+		TWeakObjectPtr<AAI_PawnBase> Pawn;
+		uint32 Generation = 1;
+		bool bOccupied = false;
+	};
+
+	TArray<FSlot> Slots;
+	TArray<uint32> FreeIndices;
+};
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_PopulationBudget.h"
+
+void FAI_PopulationBudget::Reset(const float InitialLevel)
+{
+	Level = FMath::Clamp(InitialLevel, 0.f, 1.f);
+	bHasSamples = false;
+	TimeSinceAdjust = 0.f;
+}
+
+bool FAI_PopulationBudget::Update(const FAI_PopulationBudgetSettings& Settings, const float DeltaTime,
+	const float GameThreadMs, const float AIMs)
+{
+	if (DeltaTime <= 0.f)
+		return false;
+
+	// Exponential moving average, independent of frame rate
+	if (bHasSamples)
+	{
+		const float Alpha = 1.f - FMath::Exp(-DeltaTime / Settings.SmoothingTime);
+		SmoothedGameThreadMs = FMath::Lerp(SmoothedGameThreadMs, GameThreadMs, Alpha);
+		SmoothedAIMs = FMath::Lerp(SmoothedAIMs, AIMs, Alpha);
+	}
+	else
+	{
+		SmoothedGameThreadMs = GameThreadMs;
+		SmoothedAIMs = AIMs;
+		bHasSamples = true;
+	}
+
+	TimeSinceAdjust += DeltaTime;
+	if (TimeSinceAdjust < Settings.AdjustInterval)
+		return false;
+
+	TimeSinceAdjust = 0.f;
+
+	// Whichever timing is furthest over its target decides
+	const float Load = FMath::Max(SmoothedGameThreadMs / Settings.TargetGameThreadMs, SmoothedAIMs / Settings.TargetAIMs);
+	if (FMath::Abs(Load - 1.f) <= Settings.Deadband)
+		return false;
+
+	// Step is proportional to how far off the target we are, but limited so tiers don't oscillate
+	const float Step = FMath::Clamp(1.f - Load, -Settings.MaxStepDown, Settings.MaxStepUp);
+	const float NewLevel = FMath::Clamp(Level + Step, 0.f, 1.f);
+
+	if (FMath::IsNearlyEqual(NewLevel, Level))
+		return false;
+
+	Level = NewLevel;
+	return true;
+}
+
+int32 FAI_PopulationBudget::GetThinkingCharacters(const FAI_PopulationBudgetSettings& Settings) const
+{
+	return FMath::RoundToInt(FMath::Lerp(static_cast<float>(Settings.MinThinkingCharacters),
+		static_cast<float>(Settings.MaxThinkingCharacters), Level));
+}
+
+int32 FAI_PopulationBudget::GetIntelligentCharacters(const FAI_PopulationBudgetSettings& Settings) const
+{
+	return FMath::RoundToInt(FMath::Lerp(static_cast<float>(Settings.MinIntelligentCharacters),
+		static_cast<float>(Settings.MaxIntelligentCharacters), Level));
+}
+
+float FAI_PopulationBudget::GetDistanceScale(const FAI_PopulationBudgetSettings& Settings) const
+{
+	return FMath::Lerp(Settings.MinDistanceScale, Settings.MaxDistanceScale, Level);
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI_PopulationBudget.generated.h"
+
+/**
+ * Bounds and tuning for the adaptive AI population budget
+ */
+USTRUCT(BlueprintType)
+struct FAI_PopulationBudgetSettings
+{
+	GENERATED_BODY()
+
+	// When false the Level Controller always uses its configured counts and bands
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bEnabled = true;
+
+	// Game thread time per frame the budget aims to stay under
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 1, Units = "ms"))
+	float TargetGameThreadMs = 14.f;
+
+	// Level Controller time (game thread + LOD pass) per frame the budget aims to stay under
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.1, Units = "ms"))
+	float TargetAIMs = 1.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 MinThinkingCharacters = 8;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 MaxThinkingCharacters = 40;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 MinIntelligentCharacters = 3;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 MaxIntelligentCharacters = 16;
+
+	// Scale applied to every band's Enter and Exit distance
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.1))
+	float MinDistanceScale = 0.6f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.1))
+	float MaxDistanceScale = 1.25f;
+
+	// Time constant of the timing average, longer reacts slower to spikes
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.05, Units = "s"))
+	float SmoothingTime = 1.f;
+
+	// Seconds between adjustments, so a change shows up in the timings before the next one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.05, Units = "s"))
+	float AdjustInterval = 0.5f;
+
+	// Fraction around the targets where nothing is adjusted
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0, ClampMax = 0.5))
+	float Deadband = 0.1f;
+
+	// Largest change of the budget level (0 - 1) per adjustment, lowering and raising
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.01, ClampMax = 1))
+	float MaxStepDown = 0.15f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0.01, ClampMax = 1))
+	float MaxStepUp = 0.05f;
+};
+
+/**
+ * Closed loop controller that moves a single budget level between 0 (Min caps) and 1 (Max caps)
+ * from the smoothed game thread and AI timings, it lowers quickly and raises slowly
+ */
+class FAI_PopulationBudget
+{
+public:
+	void Reset(float InitialLevel);
+
+	// Feeds one frame of timings, returns true if the level changed
+	bool Update(const FAI_PopulationBudgetSettings& Settings, float DeltaTime, float GameThreadMs, float AIMs);
+
+	FORCEINLINE float GetLevel() const { return Level; }
+	FORCEINLINE float GetSmoothedGameThreadMs() const { return SmoothedGameThreadMs; }
+	FORCEINLINE float GetSmoothedAIMs() const { return SmoothedAIMs; }
+
+	int32 GetThinkingCharacters(const FAI_PopulationBudgetSettings& Settings) const;
+	int32 GetIntelligentCharacters(const FAI_PopulationBudgetSettings& Settings) const;
+	float GetDistanceScale(const FAI_PopulationBudgetSettings& Settings) const;
+
+private:
+	float Level = 1.f;
+
+	float SmoothedGameThreadMs = 0.f;
+	float SmoothedAIMs = 0.f;
+	bool bHasSamples = false;
+
+	float TimeSinceAdjust = 0.f;
+};
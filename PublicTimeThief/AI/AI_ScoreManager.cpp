@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_ScoreManager.h"
+#include "AI_LevelController.h"
+#include "AI_PawnRegistry.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Float.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+#include "ProjectTimeThief/AI/Brain/AI_ControllerBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Score Manager"), STAT_AI_ScoreManager, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Blackboard Score Writes"), STAT_AI_ScoreWrites, STATGROUP_TimeThiefAI);
+
+namespace
+{
+	// Never a real score, so a slot holding it is always written
+	constexpr float UnwrittenValue = TNumericLimits<float>::Lowest();
+}
+
+void FAI_ScoreManager::Add(const int32 Slot, const AAI_PawnBase* Pawn)
+{
+	if (Slot >= ThinkingMask.Num())
+		SetNum(Slot + 1);
+
+	Values[EAI_Score::TimeSinceDestroy][Slot] = -1.f;
+	TimeToForgetDestroy[Slot] = Pawn->GetTimeToForgetDestroy();
+	ThinkingMask[Slot] = 0;
+	Blackboards[Slot].Reset();
+	CachedAssets[Slot].Reset();
+	InvalidateWritten(Slot);
+}
+
+void FAI_ScoreManager::Remove(const int32 Slot)
+{
+	if (!ThinkingMask.IsValidIndex(Slot))
+		return;
+
+	Values[EAI_Score::TimeSinceDestroy][Slot] = -1.f;
+	ThinkingMask[Slot] = 0;
+	Blackboards[Slot].Reset();
+	CachedAssets[Slot].Reset();
+}
+
+void FAI_ScoreManager::SetTimeSinceDestroy(const int32 Slot, const float Time)
+{
+	if (ThinkingMask.IsValidIndex(Slot))
+		Values[EAI_Score::TimeSinceDestroy][Slot] = Time;
+}
+
+float FAI_ScoreManager::GetTimeSinceDestroy(const int32 Slot) const
+{
+	return ThinkingMask.IsValidIndex(Slot) ? Values[EAI_Score::TimeSinceDestroy][Slot] : -1.f;
+}
+
+void FAI_ScoreManager::Update(const FAI_PawnRegistry& Registry, const float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AI_ScoreManager);
+
+	const int32 NumSlots = Registry.Num();
+	SetNum(NumSlots);
+
+	// Gather the scores gameplay wrote on the AI this frame
+	for (int32 Slot = 0; Slot < NumSlots; Slot++)
+	{
+		const AAI_PawnBase* Pawn = Registry.GetPawn(Slot);
+		const AAI_ControllerBase* AIController = Pawn ? Pawn->GetAIController() : nullptr;
+		UBlackboardComponent* Blackboard = AIController ? AIController->GetBlackboardComponent() : nullptr;
+
+		if (!Pawn || !Pawn->IsThinking() || !IsValid(Blackboard) || !Blackboard->GetBlackboardAsset())
+		{
+			// Whatever was written is stale by the time the AI thinks again
+			if (ThinkingMask[Slot])
+				InvalidateWritten(Slot);
+			ThinkingMask[Slot] = 0;
+			continue;
+		}
+
+		ThinkingMask[Slot] = 1;
+		Values[EAI_Score::Health][Slot] = Pawn->Health;
+		Values[EAI_Score::Fear][Slot] = Pawn->Fear;
+		Values[EAI_Score::Confidence][Slot] = Pawn->Confidence;
+		Values[EAI_Score::Suspicion][Slot] = Pawn->Suspicion;
+
+		if (Blackboards[Slot].Get() != Blackboard || CachedAssets[Slot].Get() != Blackboard->GetBlackboardAsset())
+			CacheKeys(Slot, Pawn, Blackboard);
+	}
+
+	// Destroy timers of thinking AI, one branch free pass over the packed arrays
+	{
+		float* Times = Values[EAI_Score::TimeSinceDestroy].GetData();
+		const float* Forget = TimeToForgetDestroy.GetData();
+		const uint8* Mask = ThinkingMask.GetData();
+
+		for (int32 Slot = 0; Slot < NumSlots; Slot++)
+		{
+			const float Advanced = Times[Slot] + DeltaTime * Mask[Slot];
+			Times[Slot] = (Times[Slot] < 0.f || Advanced >= Forget[Slot]) ? -1.f : Advanced;
+		}
+	}
+
+	// Only changed values reach the blackboard, by key ID instead of by name
+	uint32 NumWrites = 0;
+	for (int32 Slot = 0; Slot < NumSlots; Slot++)
+	{
+		if (!ThinkingMask[Slot])
+			continue;
+
+		UBlackboardComponent* Blackboard = Blackboards[Slot].Get();
+		if (!Blackboard)
+			continue;
+
+		for (uint8 Score = 0; Score < EAI_Score::Num; Score++)
+		{
+			const float Value = Values[Score][Slot];
+			if (Value == Written[Score][Slot] || Keys[Score][Slot] == FBlackboard::InvalidKey)
+				continue;
+
+			Blackboard->SetValue<UBlackboardKeyType_Float>(Keys[Score][Slot], Value);
+			Written[Score][Slot] = Value;
+			NumWrites++;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_AI_ScoreWrites, NumWrites);
+}
+
+void FAI_ScoreManager::SetNum(const int32 Num)
+{
+	if (ThinkingMask.Num() >= Num)
+		return;
+
+	const int32 OldNum = ThinkingMask.Num();
+
+	for (uint8 Score = 0; Score < EAI_Score::Num; Score++)
+	{
+		Values[Score].SetNumZeroed(Num, false);
+		Written[Score].SetNum(Num, false);
+		Keys[Score].SetNum(Num, false);
+
+		for (int32 Slot = OldNum; Slot < Num; Slot++)
+		{
+			Written[Score][Slot] = UnwrittenValue;
+			Keys[Score][Slot] = FBlackboard::InvalidKey;
+		}
+	}
+
+	for (int32 Slot = OldNum; Slot < Num; Slot++)
+		Values[EAI_Score::TimeSinceDestroy][Slot] = -1.f;
+
+	TimeToForgetDestroy.SetNumZeroed(Num, false);
+	ThinkingMask.SetNumZeroed(Num, false);
+	Blackboards.SetNum(Num, false);
+	CachedAssets.SetNum(Num, false);
+}
+
+void FAI_ScoreManager::CacheKeys(const int32 Slot, const AAI_PawnBase* Pawn, UBlackboardComponent* Blackboard)
+{
+	Keys[EAI_Score::Health][Slot] = Blackboard->GetKeyID(Pawn->HealthKey);
+	Keys[EAI_Score::Fear][Slot] = Blackboard->GetKeyID(Pawn->FearKey);
+	Keys[EAI_Score::Confidence][Slot] = Blackboard->GetKeyID(Pawn->ConfidenceKey);
+	Keys[EAI_Score::Suspicion][Slot] = Blackboard->GetKeyID(Pawn->SusKey);
+	Keys[EAI_Score::TimeSinceDestroy][Slot] = Blackboard->GetKeyID(Pawn->TimeSinceDestroyKey);
+
+	Blackboards[Slot] = Blackboard;
+	CachedAssets[Slot] = Blackboard->GetBlackboardAsset();
+	InvalidateWritten(Slot);
+}
+
+void FAI_ScoreManager::InvalidateWritten(const int32 Slot)
+{
+	for (uint8 Score = 0; Score < EAI_Score::Num; Score++)
+		Written[Score][Slot] = UnwrittenValue;
+}
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BehaviorTreeTypes.h"
+
+class AAI_PawnBase;
+class FAI_PawnRegistry;
+class UBlackboardComponent;
+class UBlackboardData;
+
+// Float scores mirrored onto every AI's blackboard
+namespace EAI_Score
+{
+	enum EType : uint8
+	{
+		Health,
+		Fear,
+		Confidence,
+		Suspicion,
+		TimeSinceDestroy,
+		Num
+	};
+}
+
+/**
+ * Packed scores of every registered AI, indexed by registry slot
+ * Advances the destroy timers in one pass and writes only the values that changed to the blackboards
+ * Game Thread only
+ */
+class FAI_ScoreManager
+{
+public:
+	// Starts tracking the AI in Slot, its blackboard gets every value on the next Update
+	void Add(int32 Slot, const AAI_PawnBase* Pawn);
+	void Remove(int32 Slot);
+
+	// Seconds since the AI was in the destroy state, -1 if it was not or has forgotten it
+	void SetTimeSinceDestroy(int32 Slot, float Time);
+	float GetTimeSinceDestroy(int32 Slot) const;
+
+	// Reads the scores of thinking AI, advances their destroy timers and writes what changed
+	void Update(const FAI_PawnRegistry& Registry, float DeltaTime);
+
+private:
+	void SetNum(int32 Num);
+	// Looks up the key IDs of the AI's blackboard, only redone when the blackboard asset changes
+	void CacheKeys(int32 Slot, const AAI_PawnBase* Pawn, UBlackboardComponent* Blackboard);
+	// Makes every value of Slot count as changed, so the next write sends all of them
+	void InvalidateWritten(int32 Slot);
+
+	TArray<float> Values[EAI_Score::Num];
+	// Last value sent to the blackboard
+	TArray<float> Written[EAI_Score::Num];
+	TArray<FBlackboard::FKey> Keys[EAI_Score::Num];
+
+	TArray<float> TimeToForgetDestroy;
+	// 1 while the AI is thinking, only thinking AI advance their timer and get written
+	TArray<uint8> ThinkingMask;
+
+	TArray<TWeakObjectPtr<UBlackboardComponent>> Blackboards;
+	TArray<TWeakObjectPtr<const UBlackboardData>> CachedAssets;
+};
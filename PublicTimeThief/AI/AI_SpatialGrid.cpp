@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_SpatialGrid.h"
+#include "AI_LevelController.h"
+#include "AI_PawnRegistry.h"
+#include "Algo/Sort.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Spatial Grid Rebuild"), STAT_AI_SpatialGridRebuild, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spatial Grid Queries"), STAT_AI_SpatialGridQueries, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spatial Grid Cells"), STAT_AI_SpatialGridCells, STATGROUP_TimeThiefAI);
+
+uint64 FAI_SpatialGrid::MakeCellKey(const int32 X, const int32 Y)
+{
+	return (static_cast<uint64>(static_cast<uint32>(X)) << 32) | static_cast<uint32>(Y);
+}
+
+void FAI_SpatialGrid::Rebuild(const FAI_PawnRegistry& Registry, const float InCellSize)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AI_SpatialGridRebuild);
+
+	CellSize = FMath::Max(InCellSize, 1.f);
+
+	// Reset keeps the allocations, the number of AI barely changes from frame to frame
+	Entries.Reset();
+	Cells.Reset();
+
+	for (int32 Slot = 0; Slot < Registry.Num(); Slot++)
+	{
+		const AAI_PawnBase* Pawn = Registry.GetPawn(Slot);
+		if (!Pawn || Pawn->bIsDead)
+			continue;
+
+		FEntry& Entry = Entries.AddDefaulted_GetRef();
+		Entry.Position = Pawn->GetActorLocation();
+		Entry.Handle = Registry.GetHandle(Slot);
+		Entry.Cell = MakeCellKey(ToCell(Entry.Position.X), ToCell(Entry.Position.Y));
+	}
+
+	Algo::SortBy(Entries, &FEntry::Cell);
+
+	for (int32 Index = 0; Index < Entries.Num(); Index++)
+	{
+		if (Index == 0 || Entries[Index].Cell != Entries[Index - 1].Cell)
+			Cells.Add(Entries[Index].Cell, FCellRange{ Index, 0 });
+
+		Cells.FindChecked(Entries[Index].Cell).Num++;
+	}
+
+	SET_DWORD_STAT(STAT_AI_SpatialGridCells, Cells.Num());
+}
+
+int32 FAI_SpatialGrid::QueryRadius(const FAI_PawnRegistry& Registry, const FVector& Location, const float Radius,
+	TArray<AAI_PawnBase*>& OutPawns, const AAI_PawnBase* Ignore) const
+{
+	INC_DWORD_STAT(STAT_AI_SpatialGridQueries);
+
+	const float RadiusSquared = FMath::Square(Radius);
+	const int32 MinX = ToCell(Location.X - Radius);
+	const int32 MaxX = ToCell(Location.X + Radius);
+	const int32 MinY = ToCell(Location.Y - Radius);
+	const int32 MaxY = ToCell(Location.Y + Radius);
+
+	const int32 StartNum = OutPawns.Num();
+
+	for (int32 X = MinX; X <= MaxX; X++)
+	{
+		for (int32 Y = MinY; Y <= MaxY; Y++)
+		{
+			const FCellRange* Range = Cells.Find(MakeCellKey(X, Y));
+			if (!Range)
+				continue;
+
+			for (int32 Index = Range->Start; Index < Range->Start + Range->Num; Index++)
+			{
+				const FEntry& Entry = Entries[Index];
+				if (FVector::DistSquared(Entry.Position, Location) > RadiusSquared)
+					continue;
+
+				AAI_PawnBase* Pawn = Registry.Resolve(Entry.Handle);
+				if (Pawn && Pawn != Ignore)
+					OutPawns.Add(Pawn);
+			}
+		}
+	}
+
+	return OutPawns.Num() - StartNum;
+}
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI_PawnHandle.h"
+
+class AAI_PawnBase;
+class FAI_PawnRegistry;
+
+/**
+ * Uniform grid over the ground plane of every living registered AI, rebuilt once a frame
+ * Radius queries resolve through the registry, so an AI destroyed since the rebuild is never returned
+ * Game Thread only
+ */
+class FAI_SpatialGrid
+{
+public:
+	// Bins every living registered AI by its current position
+	void Rebuild(const FAI_PawnRegistry& Registry, float CellSize);
+
+	// Appends the AI within Radius of Location to OutPawns, except Ignore, returns how many were added
+	int32 QueryRadius(const FAI_PawnRegistry& Registry, const FVector& Location, float Radius,
+		TArray<AAI_PawnBase*>& OutPawns, const AAI_PawnBase* Ignore = nullptr) const;
+
+	FORCEINLINE int32 Num() const { return Entries.Num(); }
+
+private:
+	// Cell coordinates packed into one key, entries are sorted by it so a cell's entries are contiguous
+	static uint64 MakeCellKey(int32 X, int32 Y);
+	FORCEINLINE int32 ToCell(const float Coordinate) const { return FMath::FloorToInt(Coordinate / CellSize); }
+
+	struct FEntry
+	{
+		FVector Position;
+		FAI_PawnHandle Handle;
+		uint64 Cell = 0;
+	};
+
+	struct FCellRange
+	{
+		int32 Start = 0;
+		int32 Num = 0;
+	};
+
+	float CellSize = 1000.f;
+
+	TArray<FEntry> Entries;
+	TMap<uint64, FCellRange> Cells;
+};
@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_SpawnScheduler.h"
+#include "AI_LevelController.h"
+#include "AI_SpawnerBase.h"
+#include "Algo/Sort.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Spawn Scheduler"), STAT_AI_SpawnScheduler, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spawn Queue Depth"), STAT_AI_SpawnQueueDepth, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Despawn Queue Depth"), STAT_AI_DespawnQueueDepth, STATGROUP_TimeThiefAI);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Spawn Latency (s)"), STAT_AI_SpawnLatency, STATGROUP_TimeThiefAI);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Despawn Latency (s)"), STAT_AI_DespawnLatency, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spawns"), STAT_AI_Spawns, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Despawns"), STAT_AI_Despawns, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Finished Deferred Spawns"), STAT_AI_FinishedSpawns, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Deferred Spawn Queue Depth"), STAT_AI_FinishQueueDepth, STATGROUP_TimeThiefAI);
+
+namespace
+{
+	float DistanceSquaredToClosest(TConstArrayView<FAI_Viewpoint> Viewpoints, const FVector& Location)
+	{
+		float Closest = MAX_flt;
+		for (const FAI_Viewpoint& Viewpoint : Viewpoints)
+			Closest = FMath::Min(Closest, FVector::DistSquared(Viewpoint.Location, Location));
+		return Closest;
+	}
+
+	bool IsInAnyView(TConstArrayView<FAI_Viewpoint> Viewpoints, const FVector& Location, const float Padding)
+	{
+		return Viewpoints.ContainsByPredicate([&Location, Padding](const FAI_Viewpoint& Viewpoint)
+			{
+				return Viewpoint.IsInFrustum(Location, Padding);
+			});
+	}
+}
+
+void FAI_SpawnScheduler::QueueSpawn(AAI_SpawnerBase* Spawner, const FVector& Location, const FRotator& Rotation, const double Time)
+{
+	FAI_ScheduledSpawn& Spawn = Spawns.AddDefaulted_GetRef();
+	Spawn.Spawner = Spawner;
+	Spawn.Location = Location;
+	Spawn.Rotation = Rotation;
+	Spawn.QueuedTime = Time;
+}
+
+void FAI_SpawnScheduler::QueueDespawn(const FAI_PawnHandle Handle, const double Time)
+{
+	FAI_ScheduledDespawn& Despawn = Despawns.AddDefaulted_GetRef();
+	Despawn.Handle = Handle;
+	Despawn.QueuedTime = Time;
+}
+
+void FAI_SpawnScheduler::QueueFinishSpawning(AAI_PawnBase* Pawn, const FTransform& Transform, const double Time)
+{
+	FAI_DeferredSpawn& Deferred = Finishing.AddDefaulted_GetRef();
+	Deferred.Pawn = Pawn;
+	Deferred.Transform = Transform;
+	Deferred.QueuedTime = Time;
+}
+
+void FAI_SpawnScheduler::Process(AAI_LevelController& LevelController, const TConstArrayView<FAI_Viewpoint> Viewpoints,
+	const double Time, const double BudgetSeconds, const int32 MaxFinishes, const float FrustumPadding, const float MaxDespawnDelay)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AI_SpawnScheduler);
+
+	LastSpawnLatency = 0.f;
+	LastDespawnLatency = 0.f;
+
+	const double StartTime = FPlatformTime::Seconds();
+	bool bRanAny = false;
+
+	auto HasBudget = [&]()
+		{
+			// Always make progress, even if one spawn is bigger than the whole budget
+			return !bRanAny || FPlatformTime::Seconds() - StartTime < BudgetSeconds;
+		};
+
+	// Deferred AI run their construction scripts and BeginPlay here, queued by earlier calls so a wave's cost is spread
+	if (Finishing.Num() > 0)
+	{
+		int32 NumRun = 0;
+		while (NumRun < Finishing.Num() && NumRun < FMath::Max(MaxFinishes, 1) && HasBudget())
+		{
+			const FAI_DeferredSpawn& Deferred = Finishing[NumRun++];
+
+			if (AAI_PawnBase* Pawn = Deferred.Pawn.Get(); IsValid(Pawn))
+			{
+				Pawn->FinishSpawning(Deferred.Transform);
+
+				// The flock was deactivated while the AI waited, it goes straight back
+				if (!IsValid(Pawn->Spawner) || !Pawn->Spawner->Sheep.Contains(Pawn))
+					LevelController.DespawnNow(Pawn);
+				else
+					LevelController.AddAIToThreadPool(Pawn);
+
+				LastSpawnLatency = FMath::Max(LastSpawnLatency, static_cast<float>(Time - Deferred.QueuedTime));
+				INC_DWORD_STAT(STAT_AI_FinishedSpawns);
+			}
+			bRanAny = true;
+		}
+		Finishing.RemoveAt(0, NumRun, false);
+		bRanAny = false;
+	}
+
+	// Viewpoints move, so the order is redone every frame
+	if (Spawns.Num() > 0)
+	{
+		for (FAI_ScheduledSpawn& Spawn : Spawns)
+			Spawn.Priority = DistanceSquaredToClosest(Viewpoints, Spawn.Location);
+
+		Algo::SortBy(Spawns, &FAI_ScheduledSpawn::Priority);
+
+		int32 NumRun = 0;
+		while (NumRun < Spawns.Num() && HasBudget())
+		{
+			const FAI_ScheduledSpawn& Spawn = Spawns[NumRun++];
+
+			if (AAI_SpawnerBase* Spawner = Spawn.Spawner.Get(); IsValid(Spawner))
+			{
+				FSpawnPoint SpawnPoint;
+				SpawnPoint.Location = Spawn.Location;
+				SpawnPoint.Rotation = Spawn.Rotation;
+				Spawner->SpawnAtLocation(SpawnPoint);
+
+				LastSpawnLatency = FMath::Max(LastSpawnLatency, static_cast<float>(Time - Spawn.QueuedTime));
+				INC_DWORD_STAT(STAT_AI_Spawns);
+			}
+			bRanAny = true;
+		}
+		Spawns.RemoveAt(0, NumRun, false);
+	}
+
+	// Despawns are the least important, anything still visible waits for a later frame
+	bRanAny = false;
+	for (int32 Index = 0; Index < Despawns.Num() && HasBudget();)
+	{
+		const FAI_ScheduledDespawn& Despawn = Despawns[Index];
+
+		AAI_PawnBase* Pawn = LevelController.ResolvePawn(Despawn.Handle);
+		if (IsValid(Pawn) && !Pawn->bIsDead && Time - Despawn.QueuedTime < MaxDespawnDelay
+			&& (Pawn->WasRecentlyRendered(0.2f) || IsInAnyView(Viewpoints, Pawn->GetActorLocation(), FrustumPadding)))
+		{
+			Index++;
+			continue;
+		}
+
+		// The dead are removed by the destroy queue and the corpse manager
+		if (IsValid(Pawn) && !Pawn->bIsDead)
+		{
+			LevelController.DespawnNow(Pawn);
+
+			LastDespawnLatency = FMath::Max(LastDespawnLatency, static_cast<float>(Time - Despawn.QueuedTime));
+			INC_DWORD_STAT(STAT_AI_Despawns);
+			bRanAny = true;
+		}
+		Despawns.RemoveAt(Index, 1, false);
+	}
+
+	SET_DWORD_STAT(STAT_AI_SpawnQueueDepth, Spawns.Num());
+	SET_DWORD_STAT(STAT_AI_FinishQueueDepth, Finishing.Num());
+	SET_DWORD_STAT(STAT_AI_DespawnQueueDepth, Despawns.Num());
+	SET_FLOAT_STAT(STAT_AI_SpawnLatency, LastSpawnLatency);
+	SET_FLOAT_STAT(STAT_AI_DespawnLatency, LastDespawnLatency);
+}
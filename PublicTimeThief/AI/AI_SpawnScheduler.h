@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI_LevelSnapshot.h"
+#include "AI_PawnHandle.h"
+
+class AAI_LevelController;
+class AAI_PawnBase;
+class AAI_SpawnerBase;
+
+// A validated spawn waiting for its turn
+struct FAI_ScheduledSpawn
+{
+	TWeakObjectPtr<AAI_SpawnerBase> Spawner;
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+	double QueuedTime = 0.0;
+	// Squared distance to the closest viewpoint, lower spawns first
+	float Priority = 0.f;
+};
+
+// An AI constructed with deferred spawning, waiting for its turn to finish spawning
+struct FAI_DeferredSpawn
+{
+	TWeakObjectPtr<AAI_PawnBase> Pawn;
+	FTransform Transform;
+	double QueuedTime = 0.0;
+};
+
+// An AI waiting to be despawned once no viewpoint can see it
+struct FAI_ScheduledDespawn
+{
+	FAI_PawnHandle Handle;
+	double QueuedTime = 0.0;
+};
+
+/**
+ * Spreads spawns and despawns over frames within a time budget
+ * Spawns closest to a viewpoint go first, despawns wait until the AI is out of every view or MaxDespawnDelay has passed
+ * Game Thread only
+ */
+class FAI_SpawnScheduler
+{
+public:
+	void QueueSpawn(AAI_SpawnerBase* Spawner, const FVector& Location, const FRotator& Rotation, double Time);
+	void QueueDespawn(FAI_PawnHandle Handle, double Time);
+	// Finishes spawning the deferred AI in a later Process, at most MaxFinishes per call
+	void QueueFinishSpawning(AAI_PawnBase* Pawn, const FTransform& Transform, double Time);
+
+	// Finishes deferred spawns from earlier calls, then runs queued spawns and despawns until BudgetSeconds is used up
+	// At least one of each is tried every call
+	void Process(AAI_LevelController& LevelController, TConstArrayView<FAI_Viewpoint> Viewpoints, double Time,
+		double BudgetSeconds, int32 MaxFinishes, float FrustumPadding, float MaxDespawnDelay);
+
+	FORCEINLINE int32 NumQueuedSpawns() const { return Spawns.Num() + Finishing.Num(); }
+	FORCEINLINE int32 NumQueuedDespawns() const { return Despawns.Num(); }
+
+	// Longest wait of the spawns and despawns run by the last Process
+	FORCEINLINE float GetLastSpawnLatency() const { return LastSpawnLatency; }
+	FORCEINLINE float GetLastDespawnLatency() const { return LastDespawnLatency; }
+
+private:
+	TArray<FAI_ScheduledSpawn> Spawns;
+	TArray<FAI_DeferredSpawn> Finishing;
+	TArray<FAI_ScheduledDespawn> Despawns;
+
+	float LastSpawnLatency = 0.f;
+	float LastDespawnLatency = 0.f;
+};
@@ -5,6 +5,15 @@
 #include "SpawnerController.h"
 #include "ProjectTimeThief/AI/NPC/AI_NPCController.h"
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spawn Validations Exhausted"), STAT_AI_SpawnValidationsExhausted, STATGROUP_TimeThiefAI);
+
+namespace
+{
+	// A spawn validation's UserData holds the attempt in its low byte and the baked point above it
+	constexpr uint32 SpawnAttemptBits = 8;
+	constexpr uint32 SpawnAttemptMask = (1u << SpawnAttemptBits) - 1;
+}
+
 // Sets default values
 AAI_SpawnerBase::AAI_SpawnerBase()
 {
@@ -24,6 +33,8 @@ AAI_SpawnerBase::AAI_SpawnerBase()
 	VisualSphereComponent->SetSphereRadius(500);
 	VisualSphereComponent->SetComponentTickEnabled(false);
 	VisualSphereComponent->SetupAttachment(RootComponent);
+
+	SpawnValidationDelegate.BindUObject(this, &AAI_SpawnerBase::OnSpawnValidated);
 }
 
 // Called when the game starts or when spawned
@@ -43,6 +54,10 @@ void AAI_SpawnerBase::BeginPlay()
 		}
 	}
 
+	// Build the flock's AI and controllers now, not when the wave spawns
+	if (LevelController)
+		LevelController->PrewarmPool(ActorToSpawn, SheepCount, GetActorTransform());
+
 	// Get NPC Controller If Null
 	if (NPCController == nullptr)
 	{
@@ -55,64 +70,187 @@ void AAI_SpawnerBase::BeginPlay()
 		}
 	}
 
-	if (!IsValid(Shepherd))
-		SpawnShepherd();
-
 	if(VisualSphereComponent)
 	{
 		Radius = VisualSphereComponent->GetScaledSphereRadius();
 		VisualSphereComponent->DestroyComponent();
 	}
+
+	// Spawners placed without baking still work, but pay for the search while loading
+	if (BakedSpawnPoints.IsEmpty())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has no baked spawn points, baking on load"), *GetActorNameOrLabel());
+		BakeSpawnPoints();
+	}
+
+	// The Level Controller activates the flock when a viewpoint comes close
+	if (bActivateByProximity && LevelController)
+		LevelController->RegisterSpawner(this);
+	else
+		ActivateFlock();
 }
 
-/**
- * 
- * @warning This Method runs on a BACKGROUND THREAD and must be thread safe
- */
-bool AAI_SpawnerBase::FindValidSpawnLocation(FVector& OutLocation, FRotator& OutRotation)
+void AAI_SpawnerBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (LevelController)
+		LevelController->UnregisterSpawner(this);
+
+	// Flock lives in the persistent level, it must not outlive its spawner's level
+	if (bFlockActive && EndPlayReason == EEndPlayReason::RemovedFromWorld)
+		DeactivateFlock();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AAI_SpawnerBase::ActivateFlock()
+{
+	if (bFlockActive || bAllDead)
+		return;
+
+	bFlockActive = true;
+
+	if (bShepherdAlive && !IsValid(Shepherd))
+		SpawnShepherd();
+
+	SpawnAll();
+}
+
+void AAI_SpawnerBase::DeactivateFlock()
 {
-	if (Shepherd)
+	if (!bFlockActive)
+		return;
+
+	bFlockActive = false;
+
+	const AAI_PawnBase* ShepherdAI = Cast<AAI_PawnBase>(Shepherd);
+	bShepherdAlive = IsValid(Shepherd) && !(ShepherdAI && ShepherdAI->bIsDead);
+
+	if (IsValid(Shepherd) && bShepherdAlive)
 	{
-		if(const UCapsuleComponent* Capsule = Cast<UCapsuleComponent>(Shepherd->GetComponentByClass(UCapsuleComponent::StaticClass())); IsValid(Capsule))
+		if (AAAI_NPCBase* NPC = Cast<AAAI_NPCBase>(Shepherd); IsValid(NPC))
+			NPCController->RemoveNPCFromThreadPool(NPC);
+		else if (AAI_PawnBase* Pawn = Cast<AAI_PawnBase>(Shepherd); IsValid(Pawn))
 		{
-			bool bSpawnLocationFound = false;
-			const float AdjustedHalfHeight = Capsule->GetScaledCapsuleHalfHeight() - 10;
+			// It may wait to despawn after the flock is active again, its death must not touch the new flock
+			Pawn->Spawner = nullptr;
+			LevelController->RemoveAIFromThreadPool(Pawn);
+		}
+	}
+	Shepherd = nullptr;
+
+	DespawnAll();
+}
+
+void AAI_SpawnerBase::BakeSpawnPoints()
+{
+	UWorld* World = GetWorld();
+	const UNavigationSystemV1* Navigation = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(World);
+	if (!World || !Navigation)
+		return;
+
+	// In the editor the radius is still on the visual sphere
+	const float SpawnRadius = VisualSphereComponent ? VisualSphereComponent->GetScaledSphereRadius() : Radius;
+
+	float CapsuleRadius, CapsuleHalfHeight;
+	GetSpawnCapsule(CapsuleRadius, CapsuleHalfHeight);
+	const float AdjustedHalfHeight = CapsuleHalfHeight - 10;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AI_BakeSpawnPoints), false, this);
+	const FCollisionShape Shape = FCollisionShape::MakeCapsule(CapsuleRadius, AdjustedHalfHeight);
 
-			FNavLocation NavLocation;
-			const UNavigationSystemV1* Navigation = UNavigationSystemV1::GetCurrent(Shepherd->GetWorld());
+	// Marks the level dirty when baked in the editor
+	Modify();
 
-			while(!bSpawnLocationFound)
+	BakedSpawnPoints.Reset();
+	NextSpawnPoint = 0;
+
+	const int32 MaxAttempts = NumSpawnPointsToBake * BakeAttemptsPerPoint;
+	for (int32 Attempt = 0; Attempt < MaxAttempts && BakedSpawnPoints.Num() < NumSpawnPointsToBake; Attempt++)
+	{
+		FNavLocation NavLocation;
+		if (!Navigation->GetRandomPointInNavigableRadius(GetActorLocation(), SpawnRadius, NavLocation))
+			continue;
+
+		// Keep the points spread out
+		const bool bTooClose = BakedSpawnPoints.ContainsByPredicate([this, &NavLocation](const FSpawnPoint& Point)
 			{
-				// Get Spot
-				if (Navigation && Navigation->GetRandomPointInNavigableRadius(GetActorLocation(), Radius, NavLocation))
-				{
-					// Check If Not In Another Object
-					DrawDebugSphere(GetWorld(), NavLocation.Location, 20, 8, FColor::Cyan);
+				return FVector::DistSquared2D(Point.Location, NavLocation.Location) < FMath::Square(MinSpawnPointSpacing);
+			});
+		if (bTooClose)
+			continue;
+
+		// Check If Not In Another Object
+		const FVector Start = NavLocation.Location + FVector::UpVector * AdjustedHalfHeight;
+		if (World->OverlapBlockingTestByChannel(Start, FQuat::Identity, ECollisionChannel::ECC_Pawn, Shape, QueryParams))
+			continue;
+
+		FSpawnPoint& SpawnPoint = BakedSpawnPoints.AddDefaulted_GetRef();
+		SpawnPoint.Location = NavLocation.Location + (CapsuleHalfHeight * FVector(0, 0, 1.2));
+		SpawnPoint.Rotation = FRotator(0, FMath::RandRange(-180, 180), 0);
+	}
 
-					FVector Start = NavLocation.Location + FVector::UpVector * AdjustedHalfHeight;
-					FVector End = Start + FVector(0,0,0.1f);
-					FQuat Quat = FQuat(Start, 0);
+	if (BakedSpawnPoints.Num() < NumSpawnPointsToBake)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s baked %d of %d spawn points"), *GetActorNameOrLabel(),
+			BakedSpawnPoints.Num(), NumSpawnPointsToBake);
+	}
+}
 
-					bSpawnLocationFound = !GetWorld()->SweepSingleByChannel(Hit, Start, End, Quat, ECollisionChannel::ECC_Pawn,
-						FCollisionShape::MakeCapsule(Capsule->GetScaledCapsuleRadius(), AdjustedHalfHeight));
+void AAI_SpawnerBase::GetSpawnCapsule(float& OutRadius, float& OutHalfHeight) const
+{
+	OutRadius = CapsuleComponent->GetScaledCapsuleRadius();
+	OutHalfHeight = CapsuleComponent->GetScaledCapsuleHalfHeight();
+
+	if (const APawn* Defaults = ActorToSpawn ? ActorToSpawn->GetDefaultObject<APawn>() : nullptr; Defaults && Defaults->GetRootComponent())
+		Defaults->GetSimpleCollisionCylinder(OutRadius, OutHalfHeight);
+}
 
-					DrawDebugCapsule(GetWorld(), End, Capsule->GetScaledCapsuleRadius(),
-									 AdjustedHalfHeight, Quat, FColor::Magenta, false, 3);
+bool AAI_SpawnerBase::IsSpawnPointOccupied(const FSpawnPoint& SpawnPoint, const float OccupiedRadius) const
+{
+	const float OccupiedRadiusSquared = FMath::Square(OccupiedRadius);
 
-					OutLocation = NavLocation.Location + (Capsule->GetScaledCapsuleHalfHeight() * FVector(0, 0, 1.2));
-				}
-			}
-			OutRotation = FRotator(0, FMath::RandRange(-180, 180), 0);
+	if (IsValid(Shepherd) && FVector::DistSquared2D(Shepherd->GetActorLocation(), SpawnPoint.Location) < OccupiedRadiusSquared)
+		return true;
 
+	for (const APawn* Pawn : Sheep)
+	{
+		if (IsValid(Pawn) && FVector::DistSquared2D(Pawn->GetActorLocation(), SpawnPoint.Location) < OccupiedRadiusSquared)
 			return true;
-		}
 	}
 	return false;
 }
 
+/**
+ * Walks the baked points from where the last pick stopped, so consecutive requests in a wave get different points
+ */
+int32 AAI_SpawnerBase::FindValidSpawnPoint()
+{
+	const int32 NumPoints = BakedSpawnPoints.Num();
+	if (NumPoints == 0)
+		return INDEX_NONE;
+
+	float CapsuleRadius, CapsuleHalfHeight;
+	GetSpawnCapsule(CapsuleRadius, CapsuleHalfHeight);
+
+	for (int32 Offset = 0; Offset < NumPoints; Offset++)
+	{
+		const int32 Index = (NextSpawnPoint + Offset) % NumPoints;
+		const FSpawnPoint& SpawnPoint = BakedSpawnPoints[Index];
+
+		if (IsSpawnPointOccupied(SpawnPoint, CapsuleRadius * 2.f))
+			continue;
+
+		NextSpawnPoint = (Index + 1) % NumPoints;
+		return Index;
+	}
+	return INDEX_NONE;
+}
+
 void AAI_SpawnerBase::SpawnShepherd()
 {
-	Shepherd = GetWorld()->SpawnActor<APawn>(ActorToSpawn, GetActorLocation(), GetActorRotation());
+	Shepherd = LevelController ? LevelController->SpawnFromPool(ActorToSpawn, GetActorTransform()) : nullptr;
+	if (!IsValid(Shepherd))
+		Shepherd = GetWorld()->SpawnActor<APawn>(ActorToSpawn, GetActorLocation(), GetActorRotation());
 
 	// Add Shepherd to overhead controller
 	if (AAI_PawnBase* AI = Cast<AAI_PawnBase>(Shepherd); IsValid(AI))
@@ -124,6 +262,7 @@ void AAI_SpawnerBase::SpawnShepherd()
 
 		AI->bIsShepherd = true;
 		AI->Spawner = this;
+		AI->WriteSpawnSetupToBlackboard();
 	}
 	else if (AAAI_NPCBase* NPC = Cast<AAAI_NPCBase>(Shepherd); IsValid(NPC))
 	{
@@ -134,12 +273,13 @@ void AAI_SpawnerBase::SpawnShepherd()
 	}
 }
 
+// Every missing sheep's validation is sent this frame, physics answers them together
 void AAI_SpawnerBase::SpawnAll()
 {
-	uint8 Counter = SheepCount;
+	// Validations still in flight become sheep on their own
+	int32 Counter = SheepCount - Sheep.Num() - PendingSpawnValidations;
 	while (Counter --> 0)
 	{
-		//(new FAutoDeleteAsyncTask<FAI_SpawnerThread>(this))->StartBackgroundTask();
 		PrepareSpawn();
 	}
 }
@@ -153,9 +293,11 @@ bool AAI_SpawnerBase::DespawnAll()
 		if (AAAI_NPCBase* NPC = Cast <AAAI_NPCBase>(Actor); IsValid(NPC))
 			NPCController->RemoveNPCFromThreadPool(NPC);
 		else if (AAI_PawnBase* Pawn = Cast<AAI_PawnBase>(Actor); IsValid(Pawn))
+		{
+			// Waits to despawn on its own, no longer one of this spawner's sheep
+			Pawn->Spawner = nullptr;
 			LevelController->RemoveAIFromThreadPool(Pawn);
-
-		Sheep.Remove(Actor);
+		}
 	}
 	Sheep.Reset();
 	return true;
@@ -164,16 +306,62 @@ bool AAI_SpawnerBase::DespawnAll()
 
 void AAI_SpawnerBase::PrepareSpawn()
 {
-	FSpawnPoint SpawnPoint;
+	RequestSpawnValidation(0);
+}
+
+bool AAI_SpawnerBase::RequestSpawnValidation(const uint32 Attempt)
+{
+	const int32 PointIndex = FindValidSpawnPoint();
+	if (PointIndex == INDEX_NONE)
+		return false;
+
+	const FSpawnPoint& SpawnPoint = BakedSpawnPoints[PointIndex];
+
+	float CapsuleRadius, CapsuleHalfHeight;
+	GetSpawnCapsule(CapsuleRadius, CapsuleHalfHeight);
+
+	// Something may have moved onto the baked point since it was baked
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AI_SpawnValidation), false, this);
+	GetWorld()->AsyncOverlapByChannel(SpawnPoint.Location, FQuat::Identity, ECollisionChannel::ECC_Pawn,
+		FCollisionShape::MakeCapsule(CapsuleRadius, CapsuleHalfHeight - 10), QueryParams,
+		FCollisionResponseParams::DefaultResponseParam, &SpawnValidationDelegate,
+		(static_cast<uint32>(PointIndex) << SpawnAttemptBits) | Attempt);
+
+	PendingSpawnValidations++;
+	return true;
+}
+
+void AAI_SpawnerBase::OnSpawnValidated(const FTraceHandle& TraceHandle, FOverlapDatum& OverlapDatum)
+{
+	PendingSpawnValidations--;
+
+	const bool bBlocked = OverlapDatum.OutOverlaps.ContainsByPredicate([](const FOverlapResult& Overlap)
+		{
+			return Overlap.bBlockingHit;
+		});
 
-	if(FindValidSpawnLocation(SpawnPoint.Location, SpawnPoint.Rotation))
+	const uint32 Attempt = OverlapDatum.UserData & SpawnAttemptMask;
+	const int32 PointIndex = static_cast<int32>(OverlapDatum.UserData >> SpawnAttemptBits);
+
+	if (bBlocked)
 	{
-		const FSpawnRequest Request = FSpawnRequest(SpawnPoint, this);
+		if (static_cast<int32>(Attempt) + 1 < MaxSpawnValidationAttempts && RequestSpawnValidation(Attempt + 1))
+			return;
 
-		SpawnController->Mutex.Lock();
-		SpawnController->SpawnRequests.Enqueue(Request);
-		SpawnController->Mutex.Unlock();
+		// The flock stays a sheep short until it is activated again
+		INC_DWORD_STAT(STAT_AI_SpawnValidationsExhausted);
+		UE_LOG(LogTemp, Warning, TEXT("%s found no free spawn point in %d attempts"), *GetName(), MaxSpawnValidationAttempts);
+		return;
 	}
+
+	// The points may have been baked again while the overlap was in flight
+	const FRotator Rotation = BakedSpawnPoints.IsValidIndex(PointIndex)
+		? BakedSpawnPoints[PointIndex].Rotation
+		: FRotator(0, FMath::RandRange(-180, 180), 0);
+
+	// Spawned when the Level Controller's spawn scheduler gets to it
+	if (LevelController && bFlockActive)
+		LevelController->QueueSpawn(this, OverlapDatum.Pos, Rotation);
 }
 
 void AAI_SpawnerBase::DespawnByPointer(APawn* Pointer)
@@ -198,7 +386,19 @@ bool AAI_SpawnerBase::IsFinishedDespawning() const
 
 APawn* AAI_SpawnerBase::SpawnAtLocation(const FSpawnPoint& SpawnPoint)
 {
-	APawn* SpawnedActor = GetWorld()->SpawnActor<APawn>(ActorToSpawn, SpawnPoint.Location, SpawnPoint.Rotation);
+	// Deactivated, or already full from spawns queued before a reactivation
+	if (!bFlockActive || Sheep.Num() >= SheepCount)
+		return nullptr;
+
+	const FTransform SpawnTransform(SpawnPoint.Rotation, SpawnPoint.Location);
+
+	// AI come out of the Level Controller's pool or are spawned deferred, anything else is spawned
+	APawn* SpawnedActor = LevelController
+		? LevelController->SpawnFromPool(ActorToSpawn, SpawnTransform, true)
+		: nullptr;
+
+	if (!IsValid(SpawnedActor))
+		SpawnedActor = GetWorld()->SpawnActor<APawn>(ActorToSpawn, SpawnPoint.Location, SpawnPoint.Rotation);
 
 	if (!IsValid(SpawnedActor))
 	{
@@ -213,16 +413,33 @@ APawn* AAI_SpawnerBase::SpawnAtLocation(const FSpawnPoint& SpawnPoint)
 	}
 	Mutex.Unlock();
 
-	// TODO: Run Final Setup i.e. Path Setup + Blackboard Values
-	
 	if (AAI_PawnBase* AI = Cast<AAI_PawnBase>(SpawnedActor))
 	{
+		// Set up before BeginPlay, so the AI starts with its path, combat type and tier
 		if (Path)
 			AI->SetPath(Path);
-
-		LevelController->AddAIToThreadPool(AI);
+		if (SheepCombatType != ECombatType::None)
+			AI->SetCombatType(SheepCombatType);
 
 		AI->Spawner = this;
+
+		TEnumAsByte<EControllerStatus::EType> SpawnStatus;
+		bool bSpawnRendering;
+		LevelController->GetSpawnTier(SpawnPoint.Location, SpawnStatus, bSpawnRendering);
+		AI->SetSpawnTier(SpawnStatus, bSpawnRendering);
+
+		// Deferred AI finish spawning and are registered by the scheduler on a later frame
+		if (!AI->IsActorInitialized())
+		{
+			LevelController->QueueFinishSpawning(AI, SpawnTransform);
+		}
+		else
+		{
+			// Pooled AI were possessed in an earlier life, OnPossess never saw this setup
+			AI->WriteSpawnSetupToBlackboard();
+			AI->ApplySpawnTier();
+			LevelController->AddAIToThreadPool(AI);
+		}
 	}
 	else if (AAAI_NPCBase* NPC = Cast<AAAI_NPCBase>(SpawnedActor))
 	{
@@ -242,7 +459,7 @@ void AAI_SpawnerBase::KillSheepByPtr(APawn* SheepPtr)
 		Sheep.Remove(SheepPtr);
 		SheepCount--;
 
-		if(SheepCount == 0 && Shepherd == nullptr || (Shepherd->GetClass() == AAI_PawnBase::StaticClass() && Cast<AAI_PawnBase>(Shepherd)->bIsDead))
+		if((SheepCount == 0 && Shepherd == nullptr) || (Shepherd && Shepherd->GetClass() == AAI_PawnBase::StaticClass() && Cast<AAI_PawnBase>(Shepherd)->bIsDead))
 		{
 			bAllDead = true;
 			SpawnController->RemoveSpawner(this);
@@ -269,21 +486,4 @@ void AAI_SpawnerBase::FindNewShepherd()
 	}
 }
 
-//================================
-
-FAI_SpawnerThread::FAI_SpawnerThread(AAI_SpawnerBase* SpawnerBase)
-{
-	Spawner = SpawnerBase;
-}
-
-FAI_SpawnerThread::~FAI_SpawnerThread()
-{
-	// Do Nothing
-}
-
-void FAI_SpawnerThread::DoWork() const
-{
-	Spawner->PrepareSpawn();
-}
-
 
@@ -0,0 +1,169 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SphereComponent.h"
+#include "GameFramework/Actor.h"
+#include "AI_LevelController.h"
+#include "ProjectTimeThief/AI/Navigation/NavPath.h"
+#include "AI_SpawnerBase.generated.h"
+
+class ANPC_LevelController;
+class ASpawnerController;
+class UBillboardComponent;
+
+// Where and how a single sheep is placed
+USTRUCT()
+struct FSpawnPoint
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere)
+	FVector Location = FVector::ZeroVector;
+
+	UPROPERTY(VisibleAnywhere)
+	FRotator Rotation = FRotator::ZeroRotator;
+};
+
+UCLASS()
+class PROJECTTIMETHIEF_API AAI_SpawnerBase : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	AAI_SpawnerBase();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	// Despawns the flock when the spawner's level streams out
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditDefaultsOnly)
+	UCapsuleComponent* CapsuleComponent;
+
+	UPROPERTY(EditDefaultsOnly)
+	UBillboardComponent* BillboardComponent;
+
+	// Only shows the spawn radius in the editor, destroyed on BeginPlay
+	UPROPERTY(EditDefaultsOnly)
+	USphereComponent* VisualSphereComponent;
+
+	UPROPERTY()
+	AAI_LevelController* LevelController = nullptr;
+
+	UPROPERTY()
+	ANPC_LevelController* NPCController = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "Spawner")
+	ASpawnerController* SpawnController = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "Spawner")
+	TSubclassOf<APawn> ActorToSpawn;
+
+	UPROPERTY(EditAnywhere, Category = "Spawner")
+	ANavPath* Path = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "Spawner")
+	uint8 SheepCount = 0;
+
+	// Combat type given to every sheep before it finishes spawning, None keeps the class's own
+	UPROPERTY(EditAnywhere, Category = "Spawner")
+	TEnumAsByte<ECombatType::EType> SheepCombatType = ECombatType::None;
+
+	float Radius = 500.f;
+
+	// When false the flock spawns on BeginPlay and stays for the whole level
+	UPROPERTY(EditAnywhere, Category = "Spawner|Activation")
+	bool bActivateByProximity = true;
+
+	bool bFlockActive = false;
+
+	// All that is kept of a dormant flock, with SheepCount
+	bool bShepherdAlive = true;
+
+	// Valid places for a sheep, baked in the editor so spawning never searches
+	UPROPERTY(VisibleAnywhere, Category = "Spawner|Spawn Points")
+	TArray<FSpawnPoint> BakedSpawnPoints;
+
+	UPROPERTY(EditAnywhere, Category = "Spawner|Spawn Points", meta = (ClampMin = 1))
+	int32 NumSpawnPointsToBake = 32;
+
+	// Baked points are at least this far apart
+	UPROPERTY(EditAnywhere, Category = "Spawner|Spawn Points", meta = (ClampMin = 0))
+	float MinSpawnPointSpacing = 120.f;
+
+	// Random points tried per baked point before baking gives up
+	UPROPERTY(EditAnywhere, Category = "Spawner|Spawn Points", meta = (ClampMin = 1))
+	int32 BakeAttemptsPerPoint = 16;
+
+	// Next baked point to try, so a wave spreads over all of them
+	int32 NextSpawnPoint = 0;
+
+	// Times a sheep's spawn is validated at a new point after its point was blocked
+	UPROPERTY(EditAnywhere, Category = "Spawner|Spawn Points", meta = (ClampMin = 1, ClampMax = 255))
+	int32 MaxSpawnValidationAttempts = 3;
+
+	// Sends an async overlap for the next free spawn point, the result arrives in a later frame in OnSpawnValidated
+	bool RequestSpawnValidation(uint32 Attempt);
+	// Turns a free point into a spawn request, or tries another point if something is standing there
+	void OnSpawnValidated(const FTraceHandle& TraceHandle, FOverlapDatum& OverlapDatum);
+
+	FOverlapDelegate SpawnValidationDelegate;
+
+	// Validations sent and not answered yet, SpawnAll does not send more for them
+	int32 PendingSpawnValidations = 0;
+
+	// Radius and half height of the pawn that will be spawned
+	void GetSpawnCapsule(float& OutRadius, float& OutHalfHeight) const;
+	// Is a sheep or the shepherd standing on the point
+	bool IsSpawnPointOccupied(const FSpawnPoint& SpawnPoint, float OccupiedRadius) const;
+
+public:
+	// Finds nav points in the spawn radius that a pawn fits at and stores them in BakedSpawnPoints
+	UFUNCTION(CallInEditor, Category = "Spawner|Spawn Points")
+	void BakeSpawnPoints();
+
+	// Picks a free baked spawn point, INDEX_NONE if all of them are occupied
+	int32 FindValidSpawnPoint();
+
+	void SpawnShepherd();
+	void SpawnAll();
+	bool DespawnAll();
+
+	void PrepareSpawn();
+	void DespawnByPointer(APawn* Pointer);
+
+	// Sheep that are spawned, sheep still being validated or queued do not count
+	bool IsFinishedSpawning() const;
+	bool IsFinishedDespawning() const;
+
+	// Spawns what is left of the flock
+	void ActivateFlock();
+	// Despawns the flock, keeping only how many of it are alive
+	void DeactivateFlock();
+
+	FORCEINLINE bool IsFlockActive() const { return bFlockActive; }
+	FORCEINLINE bool ActivatesByProximity() const { return bActivateByProximity; }
+	// Pawns the flock adds when activated
+	FORCEINLINE int32 GetFlockSize() const { return SheepCount + (bShepherdAlive ? 1 : 0); }
+
+	APawn* SpawnAtLocation(const FSpawnPoint& SpawnPoint);
+
+	void KillSheepByPtr(APawn* SheepPtr);
+	void FindNewShepherd();
+
+	UPROPERTY()
+	APawn* Shepherd = nullptr;
+
+	UPROPERTY()
+	TSet<APawn*> Sheep;
+
+	FCriticalSection Mutex;
+
+	bool bAllDead = false;
+};
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI_WeaponFire.h"
+#include "AI_LevelController.h"
+#include "ProjectTimeThief/AI/Base/AI_PawnBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Shot Submit"), STAT_AI_ShotSubmit, STATGROUP_TimeThiefAI);
+DECLARE_CYCLE_STAT(TEXT("AI Shot Resolve"), STAT_AI_ShotResolve, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Shots Fired"), STAT_AI_ShotsFired, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Shots Hit"), STAT_AI_ShotsHit, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Shots Dropped"), STAT_AI_ShotsDropped, STATGROUP_TimeThiefAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("AI Shots In Flight"), STAT_AI_ShotsInFlight, STATGROUP_TimeThiefAI);
+
+void FAI_WeaponFire::Queue(const FAI_ShotRequest& Request)
+{
+	if (Request.Shooter.IsSet())
+		Requests.Add(Request);
+}
+
+void FAI_WeaponFire::Process(const AAI_LevelController& LevelController, const ECollisionChannel TraceChannel)
+{
+	UWorld& World = *LevelController.GetWorld();
+
+	if (InFlight.Num() > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_AI_ShotResolve);
+
+		// Damage may kill AI and push alerts and sounds, nothing here is touched by that
+		for (int32 Index = InFlight.Num() - 1; Index >= 0; Index--)
+		{
+			FShot& Shot = InFlight[Index];
+
+			FTraceDatum Datum;
+			if (!World.QueryTraceData(Shot.Handle, Datum))
+			{
+				// Not back yet, or too old to ever come back
+				if (!World.IsTraceHandleValid(Shot.Handle, false))
+				{
+					InFlight.RemoveAtSwap(Index, 1, false);
+					INC_DWORD_STAT(STAT_AI_ShotsDropped);
+				}
+				continue;
+			}
+
+			// A stale handle means the shooter was freed since, and may already be a new AI from the pool
+			if (AAI_PawnBase* Shooter = LevelController.ResolvePawn(Shot.Request.Shooter); IsValid(Shooter))
+			{
+				const FHitResult* Hit = Datum.OutHits.FindByPredicate([](const FHitResult& Result) { return Result.bBlockingHit; });
+				Shooter->ResolveShot(Shot.Request.Start, Shot.Request.End, Hit);
+
+				if (Hit)
+					INC_DWORD_STAT(STAT_AI_ShotsHit);
+			}
+			else
+			{
+				INC_DWORD_STAT(STAT_AI_ShotsDropped);
+			}
+
+			InFlight.RemoveAtSwap(Index, 1, false);
+		}
+	}
+
+	if (Requests.Num() > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_AI_ShotSubmit);
+
+		for (const FAI_ShotRequest& Request : Requests)
+		{
+			const AAI_PawnBase* Shooter = LevelController.ResolvePawn(Request.Shooter);
+			if (!IsValid(Shooter))
+			{
+				INC_DWORD_STAT(STAT_AI_ShotsDropped);
+				continue;
+			}
+
+			FCollisionQueryParams Params(SCENE_QUERY_STAT(AI_Shot), false, Shooter);
+			if (const AActor* Weapon = Request.Weapon.Get())
+				Params.AddIgnoredActor(Weapon);
+
+			FShot& Shot = InFlight.AddDefaulted_GetRef();
+			Shot.Request = Request;
+			Shot.Handle = World.AsyncLineTraceByChannel(EAsyncTraceType::Single, Request.Start, Request.End, TraceChannel, Params);
+			INC_DWORD_STAT(STAT_AI_ShotsFired);
+		}
+
+		Requests.Reset();
+	}
+
+	SET_DWORD_STAT(STAT_AI_ShotsInFlight, InFlight.Num());
+}
+
+void FAI_WeaponFire::Reset()
+{
+	Requests.Reset();
+	InFlight.Reset();
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+#include "AI_PawnHandle.h"
+
+class AAI_LevelController;
+
+// One hitscan shot waiting to be traced
+struct FAI_ShotRequest
+{
+	// Pooled AI are reused, a shot whose shooter was released since is dropped
+	FAI_PawnHandle Shooter;
+	// Ignored by the trace with the shooter
+	TWeakObjectPtr<const AActor> Weapon;
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+};
+
+/**
+ * Traces the AI's gunfire as async line traces, submitted together once a frame
+ * Each shot is resolved on its shooter when the trace comes back the next frame
+ * Game Thread only
+ */
+class FAI_WeaponFire
+{
+public:
+	void Queue(const FAI_ShotRequest& Request);
+
+	// Resolves the shots whose traces have come back, then submits the ones queued since the last call
+	void Process(const AAI_LevelController& LevelController, ECollisionChannel TraceChannel);
+
+	// Forgets every shot, traces in flight are never resolved
+	void Reset();
+
+	FORCEINLINE int32 NumInFlight() const { return InFlight.Num(); }
+
+private:
+	struct FShot
+	{
+		FAI_ShotRequest Request;
+		FTraceHandle Handle;
+	};
+
+	TArray<FAI_ShotRequest> Requests;
+	TArray<FShot> InFlight;
+};
@@ -2,6 +2,7 @@
 
 #include "PlayerStateBase.h"
 #include "Components/CapsuleComponent.h"
+#include "ProjectTimeThief/AI/Spawners/AI_LevelController.h"
 #include "GameFramework/ForceFeedbackAttenuation.h"
 
 UPlayerStateBase::UPlayerStateBase()
@@ -229,14 +230,23 @@ void UPlayerStateBase::Shoot()
 			if(Thief->FireMontage)
 				Thief->ThiefAnimInst->Montage_Play(Thief->FireMontage);
 
-			// Start Thread to notify nearby Enemies and NPCs
-			(new FAutoDeleteAsyncTask<FGunNotifier>(Thief->ActorsToNotify, Location))->StartBackgroundTask();
+			// Nearby AI hear the shot when the Level Controller delivers its alerts
+			if (AAI_LevelController* AILevelController = GetLevelController())
+				AILevelController->ReportGunshot(Location);
 
 			UGameplayStatics::PlaySound2D(Thief->GetWorld(), Thief->ShootSound, Thief->PlayerSoundClass->Properties.Volume, RAND_PITCH(0.95f, 1.05f));
 		}
 	}
 }
 
+AAI_LevelController* UPlayerStateBase::GetLevelController()
+{
+	if (!LevelController.IsValid())
+		LevelController = Cast<AAI_LevelController>(UGameplayStatics::GetActorOfClass(Thief->GetWorld(), AAI_LevelController::StaticClass()));
+
+	return LevelController.Get();
+}
+
 void UPlayerStateBase::StopShoot()
 {
 	// No Implementation
@@ -10,6 +10,8 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "PlayerStateBase.generated.h"
 
+class AAI_LevelController;
+
 // Define State Keys
 #define BASE 0
 #define WALK 1
@@ -123,6 +125,10 @@ protected:
 	UPROPERTY(EditAnywhere)
 	float MaxRange = 10000;
 
+	// Hears the player's gunshots for the AI, found on first use
+	TWeakObjectPtr<AAI_LevelController> LevelController;
+	AAI_LevelController* GetLevelController();
+
 	//Vaulting
 	bool Vault();
 };